@@ -0,0 +1,82 @@
+#include "builtins.hpp"
+#include <iostream>
+
+static unsigned int get_magnitude(int x) {
+    return x < 0 ? 0u - (unsigned int) x : (unsigned int) x;
+}
+
+static int builtin_abs(const int* arguments, void*) {
+    return (int) get_magnitude(arguments[0]);
+}
+
+static int builtin_min(const int* arguments, void*) {
+    return arguments[0] < arguments[1] ? arguments[0] : arguments[1];
+}
+
+static int builtin_max(const int* arguments, void*) {
+    return arguments[0] > arguments[1] ? arguments[0] : arguments[1];
+}
+
+static int builtin_gcd(const int* arguments, void*) {
+    unsigned int a = get_magnitude(arguments[0]);
+    unsigned int b = get_magnitude(arguments[1]);
+    while (b != 0) {
+        unsigned int remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return (int) a;
+}
+
+static int builtin_isqrt(const int* arguments, void*) {
+    int n = arguments[0];
+    if (n < 0) return 0;
+    int low = 0;
+    int high = n < 46341 ? n : 46340;
+    while (low < high) {
+        int middle = low + (high - low + 1) / 2;
+        if (middle <= n / middle) low = middle;
+        else high = middle - 1;
+    }
+    return low;
+}
+
+static int builtin_is_prime(const int* arguments, void*) {
+    int n = arguments[0];
+    if (n < 2) return 0;
+    if (n < 4) return 1;
+    if (n % 2 == 0 || n % 3 == 0) return 0;
+    for (int i = 5; i <= n / i; i += 6) {
+        if (n % i == 0 || n % (i + 2) == 0) return 0;
+    }
+    return 1;
+}
+
+BuiltinRegistry::BuiltinRegistry() {
+    register_builtin("abs", 1, true, builtin_abs);
+    register_builtin("min", 2, true, builtin_min);
+    register_builtin("max", 2, true, builtin_max);
+    register_builtin("gcd", 2, true, builtin_gcd);
+    register_builtin("isqrt", 1, true, builtin_isqrt);
+    register_builtin("is_prime", 1, true, builtin_is_prime);
+}
+
+void BuiltinRegistry::register_builtin(const std::string& name, int arity, bool is_pure, BuiltinFunction function, void* user_data) {
+    if (arity > MAX_ARITY) {
+        std::cerr << "Error: builtin " << name << " takes more than " << MAX_ARITY << " arguments" << std::endl;
+        return;
+    }
+    builtins[name] = Builtin {
+        .name = name,
+        .arity = arity,
+        .is_pure = is_pure,
+        .function = function,
+        .user_data = user_data
+    };
+}
+
+const Builtin* BuiltinRegistry::find_builtin(const std::string& name) const {
+    std::map<std::string, Builtin>::const_iterator builtin = builtins.find(name);
+    if (builtin == builtins.end()) return nullptr;
+    return &builtin->second;
+}
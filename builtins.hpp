@@ -0,0 +1,35 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include <string>
+#include <map>
+
+// Native functions callable from scripts. They are called directly with
+// their evaluated arguments, without entering a function scope. A pure
+// builtin must depend only on its arguments and return for every input,
+// so calls with literal arguments can be folded and calls in loops can be
+// hoisted. user_data is passed to every call, so a host can give a builtin
+// its own state; a builtin that reads state which may change is not pure.
+using BuiltinFunction = int (*)(const int* arguments, void* user_data);
+
+struct Builtin {
+    std::string name;
+    int arity;
+    bool is_pure;
+    BuiltinFunction function;
+    void* user_data;
+};
+
+class BuiltinRegistry {
+private:
+    std::map<std::string, Builtin> builtins;
+
+public:
+    static const int MAX_ARITY = 8;
+
+    BuiltinRegistry();
+    void register_builtin(const std::string& name, int arity, bool is_pure, BuiltinFunction function, void* user_data = nullptr);
+    const Builtin* find_builtin(const std::string& name) const;
+};
+
+#endif
@@ -0,0 +1,228 @@
+#include "call-stack.hpp"
+#include <iostream>
+
+static SyntaxTreeNode* get_value_node(SyntaxTreeNode* node) {
+    switch (node->node_type) {
+        case SyntaxTreeNodeType::ASSIGNMENT:
+            return static_cast<AssignmentNode*>(node)->value;
+        case SyntaxTreeNodeType::PRINT:
+            return static_cast<PrintNode*>(node)->value;
+        case SyntaxTreeNodeType::RETURN:
+            return static_cast<ReturnNode*>(node)->value;
+        default:
+            return nullptr;
+    }
+}
+
+std::size_t CallStack::estimated_memory_usage() {
+    return frames.capacity() * sizeof(Frame) + variables.estimated_memory_usage();
+}
+
+void CallStack::evaluate_arguments(FunctionNode* node) {
+    argument_values.clear();
+    for (std::pair<const std::string, SyntaxTreeNode*>& argument : node->arguments) {
+        int value = argument.second->evaluate(variables).expression_value;
+        argument_values.push_back({&argument.first, value});
+    }
+}
+
+// Expects the frame on top of the stack to be the call itself and the
+// argument values to have been evaluated in the caller's scope.
+void CallStack::enter_function(FunctionNode* node) {
+    RECORD_STAT(stats.function_calls[node->function->id]++);
+    variables.enter_function_scope();
+    for (std::pair<const std::string*, int>& argument_value : argument_values) {
+        variables.assign_variable_and_initialize_if_necessary(*argument_value.first, argument_value.second);
+    }
+    frames.back().position = 1;
+    active_calls++;
+    frames.push_back(Frame { node->function->body, 0 });
+
+    if (estimated_memory_usage() > memory_limit) abort_on_memory_limit();
+}
+
+void CallStack::exit_frame(Frame& frame) {
+    if (frame.position == 0) return;
+    if (frame.node->node_type == SyntaxTreeNodeType::WHILE) {
+        if (frame.position == 1) variables.exit_block_scope();
+        if (static_cast<WhileNode*>(frame.node)->preheader != nullptr) variables.exit_block_scope();
+    }
+    else if (frame.node->node_type == SyntaxTreeNodeType::FUNCTION_CALL) {
+        variables.exit_function_scope();
+        active_calls--;
+    }
+}
+
+// Pops frames until the innermost active call is on top of the stack.
+// Returns false if the stack was emptied without finding one.
+bool CallStack::unwind_to_function_frame() {
+    while (!frames.empty()) {
+        Frame& frame = frames.back();
+        if (frame.node->node_type == SyntaxTreeNodeType::FUNCTION_CALL && frame.position == 1) return true;
+        exit_frame(frame);
+        frames.pop_back();
+    }
+    return false;
+}
+
+void CallStack::return_from_function(int value) {
+    if (!unwind_to_function_frame()) {
+        result.return_value = value;
+        result.should_return = true;
+        return;
+    }
+    exit_frame(frames.back());
+    frames.pop_back();
+    return_register = value;
+}
+
+// Replaces the innermost active call with a call to node, so a chain of
+// tail calls runs in a constant number of frames.
+void CallStack::tail_call(FunctionNode* node) {
+    evaluate_arguments(node);
+    unwind_to_function_frame();
+    exit_frame(frames.back());
+    frames.back() = Frame { node, 0 };
+    enter_function(node);
+}
+
+void CallStack::abort_on_memory_limit() {
+    std::cerr << "Error: call stack exceeded memory limit of " << memory_limit << " bytes" << std::endl;
+    exceeded_memory_limit = true;
+    while (!frames.empty()) {
+        exit_frame(frames.back());
+        frames.pop_back();
+    }
+    // Memory use is measured by capacity, so later calls would fail too.
+    frames.shrink_to_fit();
+    variables.release_unused_memory();
+}
+
+void CallStack::step() {
+    Frame& frame = frames.back();
+    SyntaxTreeNode* node = frame.node;
+
+    switch (node->node_type) {
+        case SyntaxTreeNodeType::STATEMENT_SEQUENCE: {
+            std::vector<SyntaxTreeNode*>& statements = static_cast<StatementSequenceNode*>(node)->statements;
+            if ((std::size_t) frame.position < statements.size()) {
+                SyntaxTreeNode* statement = statements[frame.position];
+                frame.position++;
+                frames.push_back(Frame { statement, 0 });
+            } else frames.pop_back();
+            return;
+        }
+        case SyntaxTreeNodeType::IF_ELSE: {
+            IfElseNode* if_else_node = static_cast<IfElseNode*>(node);
+            int condition_value = if_else_node->condition->evaluate(variables).expression_value;
+            frame = Frame { condition_value ? if_else_node->if_block : if_else_node->else_block, 0 };
+            return;
+        }
+        case SyntaxTreeNodeType::WHILE: {
+            // Position 2 means the preheader has run and its scope is open.
+            WhileNode* while_node = static_cast<WhileNode*>(node);
+            if (frame.position == 1) variables.exit_block_scope();
+            int condition_value = while_node->condition->evaluate(variables).expression_value;
+            if (frame.position == 0 && while_node->preheader != nullptr && condition_value == 1) {
+                variables.enter_block_scope();
+                frame.position = 2;
+                frames.push_back(Frame { while_node->preheader, 0 });
+            } else if (condition_value == 1) {
+                variables.enter_block_scope();
+                frame.position = 1;
+                frames.push_back(Frame { while_node->body, 0 });
+            } else {
+                if (frame.position != 0 && while_node->preheader != nullptr) variables.exit_block_scope();
+                frames.pop_back();
+            }
+            return;
+        }
+        case SyntaxTreeNodeType::FUNCTION_CALL: {
+            if (frame.position == 0) {
+                FunctionNode* function_node = static_cast<FunctionNode*>(node);
+                evaluate_arguments(function_node);
+                enter_function(function_node);
+            } else return_from_function(0);
+            return;
+        }
+        case SyntaxTreeNodeType::ASSIGNMENT:
+        case SyntaxTreeNodeType::PRINT:
+        case SyntaxTreeNodeType::RETURN: {
+            SyntaxTreeNode* value = get_value_node(node);
+            if (value->node_type != SyntaxTreeNodeType::FUNCTION_CALL) {
+                if (node->node_type == SyntaxTreeNodeType::RETURN) return_from_function(value->evaluate(variables).expression_value);
+                else {
+                    node->evaluate(variables);
+                    frames.pop_back();
+                }
+                return;
+            }
+
+            if (frame.position == 0) {
+                if (node->node_type == SyntaxTreeNodeType::RETURN && active_calls > 0) tail_call(static_cast<FunctionNode*>(value));
+                else {
+                    frame.position = 1;
+                    frames.push_back(Frame { value, 0 });
+                }
+                return;
+            }
+
+            int value_result = return_register;
+            if (node->node_type == SyntaxTreeNodeType::RETURN) {
+                return_from_function(value_result);
+                return;
+            }
+            if (node->node_type == SyntaxTreeNodeType::ASSIGNMENT) {
+                AssignmentNode* assignment_node = static_cast<AssignmentNode*>(node);
+                variables.assign_variable_and_initialize_if_necessary(assignment_node->variable_name, value_result);
+            } else std::cout << value_result << std::endl;
+            frames.pop_back();
+            return;
+        }
+        default:
+            node->evaluate(variables);
+            frames.pop_back();
+            return;
+    }
+}
+
+// Calls node's function with argument values supplied by the host rather
+// than by argument nodes. The frames and argument buffers are reused, so
+// repeated calls do not allocate once they have grown. Returns nothing if
+// the argument count is wrong or the memory limit was hit.
+std::optional<int> CallStack::call(FunctionNode* node, std::span<const int> arguments) {
+    const std::vector<std::string>& parameters = node->function->parameters;
+    if (arguments.size() != parameters.size()) {
+        std::cerr << "Error: " << node->function->name << " expects " << parameters.size() << " arguments" << std::endl;
+        return std::nullopt;
+    }
+
+    frames.clear();
+    active_calls = 0;
+    return_register = 0;
+    exceeded_memory_limit = false;
+    result = SyntaxTreeNode::EvaluationResult();
+
+    argument_values.clear();
+    for (std::size_t i = 0; i < parameters.size(); i++) argument_values.push_back({ &parameters[i], arguments[i] });
+    frames.push_back(Frame { node, 0 });
+    enter_function(node);
+    while (!frames.empty()) step();
+
+    if (exceeded_memory_limit) return std::nullopt;
+    return return_register;
+}
+
+SyntaxTreeNode::EvaluationResult CallStack::execute(SyntaxTreeNode* root) {
+    frames.clear();
+    active_calls = 0;
+    return_register = 0;
+    exceeded_memory_limit = false;
+    result = SyntaxTreeNode::EvaluationResult();
+
+    frames.push_back(Frame { root, 0 });
+    while (!frames.empty()) step();
+
+    if (root->node_type == SyntaxTreeNodeType::FUNCTION_CALL) result.return_value = return_register;
+    return result;
+}
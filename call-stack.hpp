@@ -0,0 +1,51 @@
+#ifndef CALL_STACK_H
+#define CALL_STACK_H
+
+#include "syntax-tree.hpp"
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <span>
+#include <optional>
+
+// Executes statements with an explicit, heap allocated stack of frames
+// instead of recursing through evaluate(), so recursion depth is bounded
+// by memory_limit rather than by the size of the native stack.
+// Expressions never contain calls, so they are still evaluated directly.
+class CallStack {
+private:
+    struct Frame {
+        SyntaxTreeNode* node;
+        int position;
+    };
+
+    Variables& variables;
+    std::size_t memory_limit;
+    std::vector<Frame> frames;
+    std::vector<std::pair<const std::string*, int>> argument_values;
+    int active_calls;
+    int return_register;
+    bool exceeded_memory_limit;
+    SyntaxTreeNode::EvaluationResult result;
+
+    std::size_t estimated_memory_usage();
+    void evaluate_arguments(FunctionNode* node);
+    void enter_function(FunctionNode* node);
+    void exit_frame(Frame& frame);
+    bool unwind_to_function_frame();
+    void return_from_function(int value);
+    void tail_call(FunctionNode* node);
+    void abort_on_memory_limit();
+    void step();
+
+public:
+    static const std::size_t DEFAULT_MEMORY_LIMIT = 256 * 1024 * 1024;
+
+    CallStack(Variables& variables, std::size_t memory_limit = DEFAULT_MEMORY_LIMIT) : variables(variables), memory_limit(memory_limit), active_calls(0), return_register(0), exceeded_memory_limit(false) {}
+    SyntaxTreeNode::EvaluationResult execute(SyntaxTreeNode* root);
+    std::optional<int> call(FunctionNode* node, std::span<const int> arguments);
+    // Whether the last execute or call was cut short by the memory limit.
+    bool has_failed() { return exceeded_memory_limit; }
+};
+
+#endif
@@ -3,6 +3,8 @@
 #include <vector>
 #include <sstream>
 #include <iostream>
+#include <thread>
+#include <atomic>
 #include "debug.hpp"
 
 std::ostream& operator<<(std::ostream& o, Interpreter::Line& line) {
@@ -59,14 +61,17 @@ void Interpreter::preprocess_input_string(std::string& input_string) {
     }
 }
 
-void Interpreter::read_input_file_and_parse_into_tokens() {
-
+std::string Interpreter::read_input_file() {
     std::ifstream input_file_stream(input_file_path);
     std::stringstream input_string_stream;
     input_string_stream << input_file_stream.rdbuf();
-    std::string input_string = input_string_stream.str();
+    return input_string_stream.str();
+}
+
+void Interpreter::parse_into_tokens(std::string input_string) {
+
     preprocess_input_string(input_string);
-    input_string_stream = std::stringstream(input_string);
+    std::stringstream input_string_stream(input_string);
 
     std::string line_string;
     Line current_line;
@@ -85,12 +90,17 @@ void Interpreter::read_input_file_and_parse_into_tokens() {
 }
 
 bool Interpreter::token_is_function_name(Token& token) {
-    return function_map.find(token) != function_map.end();
+    return function_map.find(token) != function_map.end() || builtins.find_builtin(token) != nullptr;
+}
+
+// Builtin names are not reserved, so a name only starts a call when it is
+// followed by an opening parenthesis.
+bool Interpreter::token_is_function_call(Line& line, int index) {
+    return token_is_function_name(line[index]) && (std::size_t) index + 1 < line.size() && line[index + 1] == "(";
 }
 
 bool Interpreter::line_is_lone_function_call(Line& line) {
-    Token first_token = line[0];
-    return token_is_function_name(first_token);
+    return token_is_function_call(line, 0);
 }
 
 SyntaxTreeNode* Interpreter::parse_lone_function_call_node(int& start_line) {
@@ -147,22 +157,21 @@ int Interpreter::get_literal_value_from_token(const Token& token) {
 SyntaxTreeNode* Interpreter::parse_operand_token(const Token& token) {
     OperandType operand_type = token_is_variable_name(token) ? IDENTIFIER : LITERAL;
     SyntaxTreeNode* operand_node = nullptr;
-    if (operand_type == LITERAL) operand_node = new OperandNode(operand_type, get_literal_value_from_token(token), variables);
-    else operand_node = new OperandNode(operand_type, token, variables);
+    if (operand_type == LITERAL) operand_node = new OperandNode(operand_type, get_literal_value_from_token(token));
+    else operand_node = new OperandNode(operand_type, token);
     return operand_node;
 }
 
 SyntaxTreeNode* Interpreter::parse_binary_operation_node(const Token& left, const Token& op, const Token& right) {
     SyntaxTreeNode* left_operand = parse_operand_token(left);
     SyntaxTreeNode* right_operand = parse_operand_token(right);
-    return new BinaryOperationNode(binary_operation_token_to_enum(op), left_operand, right_operand, variables);
+    return new BinaryOperationNode(binary_operation_token_to_enum(op), left_operand, right_operand);
 }
 
 Interpreter::AssignmentValueType Interpreter::get_assignment_value_type(Line& line, int start_index, int end_index) {
     int length = end_index - start_index + 1;
     if (length == 1) return AssignmentValueType::OPERAND;
-    Token possible_function_name = line[start_index];
-    if (function_map.find(possible_function_name) != function_map.end()) return AssignmentValueType::FUNCTION_CALL;
+    if (token_is_function_call(line, start_index)) return AssignmentValueType::FUNCTION_CALL;
     else return AssignmentValueType::BINARY_OPERATION;
 }
 
@@ -183,7 +192,7 @@ Interpreter::FunctionSignatureDetails Interpreter::get_function_signature_detail
     int function_name_index = 0;
     if (is_definition) function_name_index = 1;
     else {
-        while (!token_is_function_name(line[function_name_index])) function_name_index++;
+        while (!token_is_function_call(line, function_name_index)) function_name_index++;
     }
     Token function_name = line[function_name_index];
 
@@ -197,8 +206,8 @@ Interpreter::FunctionSignatureDetails Interpreter::get_function_signature_detail
     }
 
     return FunctionSignatureDetails {
-        .name = function_name,
-        .inputs = input_tokens
+        .inputs = input_tokens,
+        .name = function_name
     };
 }
 
@@ -215,16 +224,26 @@ SyntaxTreeNode* Interpreter::parse_function_call_node(int& start_line) {
         argument_nodes.push_back(node);
     }
 
-    FunctionData function_data = function_map[function_name];
-    SyntaxTreeNode* function_body = function_data.body;
-    std::vector<Token> parameters = function_data.parameters; 
+    FunctionMap::iterator function = function_map.find(function_name);
+    if (function == function_map.end()) {
+        const Builtin* builtin = builtins.find_builtin(function_name);
+        if ((int) argument_nodes.size() != builtin->arity) {
+            std::cerr << "Error: " << function_name << " expects " << builtin->arity << " arguments" << std::endl;
+            has_parse_errors = true;
+            return nullptr;
+        }
+        return new BuiltinCallNode(builtin, argument_nodes);
+    }
+
+    FunctionData* function_data = &function->second;
+    std::vector<Token>& parameters = function_data->parameters;
 
     std::map<std::string, SyntaxTreeNode*> argument_map;
     for (int i = 0; i < parameters.size(); i++) {
         argument_map[parameters[i]] = argument_nodes[i];
     }
 
-    return new FunctionNode(function_body, argument_map, variables);
+    return new FunctionNode(function_data, argument_map);
 }
 
 SyntaxTreeNode* Interpreter::parse_assignment_node(int& start_line) {
@@ -235,7 +254,7 @@ SyntaxTreeNode* Interpreter::parse_assignment_node(int& start_line) {
 
     start_line++;
 
-    return new AssignmentNode(variable_name, assignment_value_node, variables);
+    return new AssignmentNode(variable_name, assignment_value_node);
 }
 
 int Interpreter::get_closing_brace_line(int opening_brace_line) {
@@ -270,9 +289,9 @@ SyntaxTreeNode* Interpreter::parse_if_else_node(int& start_line) {
     if (start_line < total_lines && lines[start_line][0] == "else") {
         start_line++;
         else_block_node = parse_braces_block(start_line);
-    } else else_block_node = new EmptyNode(variables);
+    } else else_block_node = new EmptyNode();
 
-    return new IfElseNode(binary_operation_node, if_block_node, else_block_node, variables);
+    return new IfElseNode(binary_operation_node, if_block_node, else_block_node);
 }
 
 int Interpreter::get_closing_parenthesis_index(Line& line) {
@@ -287,37 +306,91 @@ SyntaxTreeNode* Interpreter::parse_print_node(int& start_line) {
     Line& line = lines[start_line];
     int closing_parenthesis_index = get_closing_parenthesis_index(line);
     SyntaxTreeNode* print_value_node = parse_assignment_value_node(start_line, 2, closing_parenthesis_index - 1);
-    SyntaxTreeNode* node = new PrintNode(print_value_node, variables);
+    SyntaxTreeNode* node = new PrintNode(print_value_node);
     start_line++;
     return node;
 }
 
+// Bodies were parsed by parse_function_bodies, so the definition is
+// skipped. Only definitions after a missing closing brace are not found.
 SyntaxTreeNode* Interpreter::parse_function_definition(int& start_line) {
-    Line& line = lines[start_line];
-
-    FunctionSignatureDetails function_signature_details = get_function_signature_details(line, true);
-    Token function_name = function_signature_details.name;
-    std::vector<Token> parameters = function_signature_details.inputs;
+    std::map<int, int>::iterator function = function_closing_lines.find(start_line);
+    if (function == function_closing_lines.end()) {
+        has_parse_errors = true;
+        start_line++;
+        return new EmptyNode();
+    }
+    start_line = function->second + 1;
+    return new EmptyNode();
+}
 
-    start_line++;
+// Registers every function before any body is parsed, so that bodies can
+// call themselves or functions defined further down the file.
+void Interpreter::register_function_signatures() {
+    for (Line& line : lines) {
+        if (line.empty() || line[0] != "function") continue;
+        FunctionSignatureDetails function_signature_details = get_function_signature_details(line, true);
+        function_map[function_signature_details.name] = FunctionData {
+            .name = function_signature_details.name,
+            .body = nullptr,
+            .parameters = function_signature_details.inputs,
+            .id = stats.register_function(function_signature_details.name)
+        };
+    }
+}
 
-    SyntaxTreeNode* function_body_node = parse_braces_block(start_line);
+// Finds every function definition, including those nested in blocks and
+// in other functions, in source order.
+void Interpreter::find_function_bodies() {
+    for (int i = 0; i < total_lines; i++) {
+        Line& line = lines[i];
+        if (line[0] != "function") continue;
+        FunctionSignatureDetails function_signature_details = get_function_signature_details(line, true);
+        int closing_brace_line = get_closing_brace_line(i + 1);
+        if (closing_brace_line < 0) return;
+        function_closing_lines[i] = closing_brace_line;
+        function_body_start_lines.push_back({ &function_map.at(function_signature_details.name), i + 1 });
+    }
+}
 
-    function_map[function_name] = FunctionData {
-        .body = function_body_node,
-        .parameters = parameters
+// Parses every function body before the rest of the program. Large
+// programs are split across threads that take bodies from a shared
+// counter; the calling thread takes part as well. Bodies are stored in
+// source order once all are parsed, so a later definition of a name
+// replaces an earlier one as it would when parsing in order.
+void Interpreter::parse_function_bodies() {
+    std::vector<std::pair<FunctionData*, int>>& bodies = function_body_start_lines;
+    std::vector<SyntaxTreeNode*> parsed_bodies(bodies.size(), nullptr);
+    std::atomic<int> next_body(0);
+    auto parse_remaining_bodies = [this, &bodies, &parsed_bodies, &next_body]() {
+        int index;
+        while ((index = next_body++) < (int) bodies.size()) {
+            int start_line = bodies[index].second;
+            parsed_bodies[index] = parse_braces_block(start_line);
+        }
     };
 
-    SyntaxTreeNode* empty_node = new EmptyNode(variables);
+    int thread_count = std::min<int>(std::thread::hardware_concurrency(), bodies.size() / MIN_FUNCTIONS_PER_THREAD);
+    std::vector<std::thread> threads;
+    for (int i = 1; i < thread_count; i++) {
+        node_arenas.push_back(std::make_unique<NodeArena>());
+        NodeArena* arena = node_arenas.back().get();
+        threads.emplace_back([arena, &parse_remaining_bodies]() {
+            NodeArena::current = arena;
+            parse_remaining_bodies();
+        });
+    }
+    parse_remaining_bodies();
+    for (std::thread& thread : threads) thread.join();
 
-    return empty_node;
+    for (std::size_t i = 0; i < bodies.size(); i++) bodies[i].first->body = parsed_bodies[i];
 }
 
 SyntaxTreeNode* Interpreter::parse_return_node(int& start_line) {
     Line& line = lines[start_line];
     SyntaxTreeNode* value_node = parse_assignment_value_node(start_line, 1, line.size() - 1);
     start_line++;
-    return new ReturnNode(value_node, variables);
+    return new ReturnNode(value_node);
 }
 
 SyntaxTreeNode* Interpreter::parse_while_node(int& start_line) {
@@ -325,7 +398,7 @@ SyntaxTreeNode* Interpreter::parse_while_node(int& start_line) {
     SyntaxTreeNode* condition_node = parse_binary_operation_node(line[2], line[3], line[4]);
     start_line++;
     SyntaxTreeNode* body_node = parse_braces_block(start_line);
-    return new WhileNode(variables, condition_node, body_node);
+    return new WhileNode(condition_node, body_node);
 }
 
 SyntaxTreeNode* Interpreter::parse_single_statement_node(int& start_line) {
@@ -359,19 +432,103 @@ SyntaxTreeNode* Interpreter::parse_block(int& start_line, int& end_line) {
         nodes.push_back(node);
     }
     if (nodes.size() == 1) return nodes[0];
-    else return new StatementSequenceNode(nodes, variables);
+    else return new StatementSequenceNode(nodes);
 }
 
-void Interpreter::run() {
-    read_input_file_and_parse_into_tokens();
-    int start = 0;
-    int end = total_lines - 1;
-    SyntaxTreeNode* node = parse_block(start, end);
-    node->evaluate();
+// Keeps the body as it is when it cannot be expressed in the IR.
+SyntaxTreeNode* Interpreter::optimize_with_ir(const std::string& name, const std::vector<std::string>& parameters, SyntaxTreeNode* body) {
+    IrBuilder ir_builder;
+    std::unique_ptr<IrFunction> ir_function = ir_builder.build(name, parameters, body);
+    if (ir_function == nullptr) {
+        if (dump_ir) std::cerr << "; " << name << " is not supported by the IR" << std::endl << std::endl;
+        return body;
+    }
+
+    IrPassManager pass_manager(dump_ir ? &std::cerr : nullptr);
+    pass_manager.add_pass(std::make_unique<CopyPropagation>());
+    pass_manager.add_pass(std::make_unique<GlobalValueNumbering>());
+    pass_manager.add_pass(std::make_unique<DeadStoreElimination>());
+    pass_manager.run(*ir_function);
+
+    IrLowering ir_lowering;
+    SyntaxTreeNode* lowered_body = ir_lowering.lower(*ir_function);
+    if (lowered_body == nullptr) {
+        if (dump_ir) std::cerr << "; " << name << " could not be lowered from the IR" << std::endl << std::endl;
+        return body;
+    }
+    return lowered_body;
 }
 
+SyntaxTreeNode* Interpreter::optimize_syntax_tree(SyntaxTreeNode* root) {
+    root = partial_evaluator.run(root);
+    for (std::pair<const Token, FunctionData>& entry : function_map) {
+        if (entry.second.body != nullptr) entry.second.body = partial_evaluator.run(entry.second.body);
+    }
+
+    std::vector<FunctionData*> functions;
+    for (std::pair<const Token, FunctionData>& entry : function_map) functions.push_back(&entry.second);
+    for (FunctionData& specialization : partial_evaluator.get_specializations()) functions.push_back(&specialization);
+
+    root = optimize_with_ir("<program>", std::vector<std::string>(), root);
+    for (FunctionData* function : functions) {
+        if (function->body != nullptr) function->body = optimize_with_ir(function->name, function->parameters, function->body);
+    }
 
+    LoopInvariantCodeMotion loop_invariant_code_motion(functions);
+    loop_invariant_code_motion.run(root);
+    for (FunctionData* function : functions) {
+        if (function->body != nullptr) loop_invariant_code_motion.run(function->body);
+    }
 
+    NodeSpecializer node_specializer;
+    root = node_specializer.run(root);
+    for (FunctionData* function : functions) {
+        if (function->body != nullptr) function->body = node_specializer.run(function->body);
+    }
+    return root;
+}
 
+void Interpreter::set_builtin_registry(const BuiltinRegistry& builtin_registry) {
+    builtins = builtin_registry;
+}
 
+void Interpreter::set_call_stack_memory_limit(std::size_t bytes) {
+    call_stack_memory_limit = bytes;
+}
 
+void Interpreter::set_dump_ir(bool dump) {
+    dump_ir = dump;
+}
+
+bool Interpreter::compile(const std::string& source) {
+    NodeArena* previous_arena = NodeArena::current;
+    node_arenas.push_back(std::make_unique<NodeArena>());
+    NodeArena::current = node_arenas.back().get();
+
+    parse_into_tokens(source);
+    register_function_signatures();
+    find_function_bodies();
+    parse_function_bodies();
+    int start = 0;
+    int end = total_lines - 1;
+    program_root = parse_block(start, end);
+    if (!has_parse_errors) program_root = optimize_syntax_tree(program_root);
+
+    NodeArena::current = previous_arena;
+    return !has_parse_errors;
+}
+
+FunctionData* Interpreter::find_function(const std::string& name) {
+    FunctionMap::iterator function = function_map.find(name);
+    if (function == function_map.end()) return nullptr;
+    return &function->second;
+}
+
+bool Interpreter::run() {
+    if (!compile(read_input_file())) return false;
+    CallStack call_stack(variables, call_stack_memory_limit);
+    stats.tracking_allocations = true;
+    call_stack.execute(program_root);
+    stats.tracking_allocations = false;
+    return !call_stack.has_failed();
+}
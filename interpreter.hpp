@@ -2,11 +2,22 @@
 #define INTERPRETER_H
 
 #include "syntax-tree.hpp"
+#include "call-stack.hpp"
+#include "loop-invariant-code-motion.hpp"
+#include "partial-evaluator.hpp"
+#include "node-specializer.hpp"
+#include "ir-builder.hpp"
+#include "ir-passes.hpp"
+#include "ir-lowering.hpp"
+#include "node-arena.hpp"
+#include "builtins.hpp"
 #include <string>
 #include <fstream>
 #include <vector>
 #include <sstream>
 #include <iostream>
+#include <memory>
+#include <atomic>
 
 class Interpreter {
 private:
@@ -16,14 +27,23 @@ private:
     Variables variables;
     std::vector<Line> lines;
     int total_lines;
-
-    struct FunctionData {
-        SyntaxTreeNode* body;
-        std::vector<Token> parameters;
-    };
+    std::size_t call_stack_memory_limit;
+    bool dump_ir;
+    // Set by any parsing thread that finds an error.
+    std::atomic<bool> has_parse_errors;
+    SyntaxTreeNode* program_root;
 
     using FunctionMap = std::map<Token, FunctionData>;
     FunctionMap function_map;
+    BuiltinRegistry builtins;
+
+    // Function bodies, including nested definitions, are parsed up front,
+    // possibly on several threads, each allocating nodes from its own arena.
+    static const int MIN_FUNCTIONS_PER_THREAD = 16;
+    std::map<int, int> function_closing_lines;
+    std::vector<std::pair<FunctionData*, int>> function_body_start_lines;
+    std::vector<std::unique_ptr<NodeArena>> node_arenas;
+    PartialEvaluator partial_evaluator;
 
     enum StatementNodeType {
         ASSIGNMENT,
@@ -55,10 +75,12 @@ private:
     SyntaxTreeNode* parse_lone_function_call_node(int& start_line);
     FunctionSignatureDetails get_function_signature_details(Line& line, bool is_definition);
     bool token_is_function_name(Token& token);
+    bool token_is_function_call(Line& line, int index);
     SyntaxTreeNode* parse_function_call_node(int& line_number);
     AssignmentValueType get_assignment_value_type(Line& line, int start_index, int end_index);
     void preprocess_input_string(std::string& input_string);
-    void read_input_file_and_parse_into_tokens();
+    std::string read_input_file();
+    void parse_into_tokens(std::string input_string);
     bool token_is_variable_name(const Token& token);
     int get_literal_value_from_token(const Token& token);
     BinaryOperation binary_operation_token_to_enum(const Token& token);
@@ -73,10 +95,23 @@ private:
     SyntaxTreeNode* parse_print_node(int& start_line);
     SyntaxTreeNode* parse_single_statement_node(int& start_line);
     SyntaxTreeNode* parse_function_definition(int& start_line);
+    void register_function_signatures();
+    void find_function_bodies();
+    void parse_function_bodies();
+    SyntaxTreeNode* optimize_with_ir(const std::string& name, const std::vector<std::string>& parameters, SyntaxTreeNode* body);
+    SyntaxTreeNode* optimize_syntax_tree(SyntaxTreeNode* root);
     SyntaxTreeNode* parse_block(int& start_line, int& end_line);
 public:
-    Interpreter(std::string input_file_path) : input_file_path(input_file_path), variables(Variables()) {}
-    void run();
+    Interpreter() : total_lines(0), call_stack_memory_limit(CallStack::DEFAULT_MEMORY_LIMIT), dump_ir(false), has_parse_errors(false), program_root(nullptr) {}
+    Interpreter(std::string input_file_path) : input_file_path(input_file_path), variables(Variables()), total_lines(0), call_stack_memory_limit(CallStack::DEFAULT_MEMORY_LIMIT), dump_ir(false), has_parse_errors(false), program_root(nullptr) {}
+    void set_builtin_registry(const BuiltinRegistry& builtin_registry);
+    void set_call_stack_memory_limit(std::size_t bytes);
+    void set_dump_ir(bool dump);
+    // Returns false if the source has errors, in which case nothing was optimized.
+    bool compile(const std::string& source);
+    FunctionData* find_function(const std::string& name);
+    // Returns false if the program was stopped by an error.
+    bool run();
 };
 
 std::ostream& operator<<(std::ostream& o, Interpreter::Line& line);
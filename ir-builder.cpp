@@ -0,0 +1,235 @@
+#include "ir-builder.hpp"
+#include "syntax-tree-utilities.hpp"
+
+IrBasicBlock* IrBuilder::start_block(IrRegion& region) {
+    IrBasicBlock* block = function->new_block();
+    region.items.push_back(IrRegionItem { IrRegionItem::BLOCK, block, nullptr, nullptr });
+    current_block = block;
+    return block;
+}
+
+IrInstruction* IrBuilder::build_value(SyntaxTreeNode* node, Definitions& definitions) {
+    switch (node->node_type) {
+        case SyntaxTreeNodeType::OPERAND: {
+            OperandNode* operand_node = static_cast<OperandNode*>(node);
+            if (operand_node->operand_type == LITERAL) {
+                IrInstruction* constant = function->new_instruction(IR_CONSTANT, current_block);
+                constant->constant = operand_node->literal_value;
+                return constant;
+            }
+            Definitions::iterator definition = definitions.find(operand_node->identifier_value);
+            if (definition == definitions.end()) return nullptr;
+            return definition->second;
+        }
+        case SyntaxTreeNodeType::BINARY_OPERATION: {
+            BinaryOperationNode* binary_operation_node = static_cast<BinaryOperationNode*>(node);
+            IrInstruction* left = build_value(binary_operation_node->left_operand, definitions);
+            IrInstruction* right = build_value(binary_operation_node->right_operand, definitions);
+            if (left == nullptr || right == nullptr) return nullptr;
+            IrInstruction* instruction = function->new_instruction(IR_BINARY_OPERATION, current_block);
+            instruction->operation = binary_operation_node->operation;
+            instruction->operands = { left, right };
+            return instruction;
+        }
+        case SyntaxTreeNodeType::FUNCTION_CALL: {
+            FunctionNode* function_node = static_cast<FunctionNode*>(node);
+            std::vector<IrInstruction*> operands;
+            std::vector<std::string> argument_names;
+            for (std::pair<const std::string, SyntaxTreeNode*>& argument : function_node->arguments) {
+                IrInstruction* value = build_value(argument.second, definitions);
+                if (value == nullptr) return nullptr;
+                operands.push_back(value);
+                argument_names.push_back(argument.first);
+            }
+            IrInstruction* instruction = function->new_instruction(IR_FUNCTION_CALL, current_block);
+            instruction->function = function_node->function;
+            instruction->operands = operands;
+            instruction->argument_names = argument_names;
+            return instruction;
+        }
+        case SyntaxTreeNodeType::BUILTIN_CALL: {
+            BuiltinCallNode* builtin_call_node = static_cast<BuiltinCallNode*>(node);
+            std::vector<IrInstruction*> operands;
+            for (SyntaxTreeNode* argument : builtin_call_node->arguments) {
+                IrInstruction* value = build_value(argument, definitions);
+                if (value == nullptr) return nullptr;
+                operands.push_back(value);
+            }
+            IrInstruction* instruction = function->new_instruction(IR_BUILTIN_CALL, current_block);
+            instruction->builtin = builtin_call_node->builtin;
+            instruction->operands = operands;
+            return instruction;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+bool IrBuilder::build_if_else(IfElseNode* node, IrRegion& region, Definitions& definitions) {
+    IrInstruction* condition = build_value(node->condition, definitions);
+    if (condition == nullptr) return false;
+    IrBasicBlock* branch_block = current_block;
+    branch_block->branch_condition = condition;
+
+    IrRegionItem item { IrRegionItem::IF, nullptr, std::make_unique<IrRegion>(), std::make_unique<IrRegion>() };
+    IrRegion* branch_regions[2] = { item.first.get(), item.second.get() };
+    SyntaxTreeNode* branch_nodes[2] = { node->if_block, node->else_block };
+    Definitions branch_definitions[2] = { definitions, definitions };
+    IrBasicBlock* branch_ends[2];
+    bool branch_terminated[2];
+    for (int i = 0; i < 2; i++) {
+        branch_block->successors.push_back(start_block(*branch_regions[i]));
+        terminated = false;
+        if (!build_statement(branch_nodes[i], *branch_regions[i], branch_definitions[i])) return false;
+        branch_ends[i] = current_block;
+        branch_terminated[i] = terminated;
+    }
+    region.items.push_back(std::move(item));
+
+    if (branch_terminated[0] && branch_terminated[1]) {
+        terminated = true;
+        return true;
+    }
+    terminated = false;
+    IrBasicBlock* join_block = start_block(region);
+    for (int i = 0; i < 2; i++) {
+        if (!branch_terminated[i]) branch_ends[i]->successors.push_back(join_block);
+    }
+    if (branch_terminated[0] || branch_terminated[1]) {
+        definitions = branch_definitions[branch_terminated[0] ? 1 : 0];
+        return true;
+    }
+
+    // A variable assigned on only one side may not exist after the join.
+    Definitions joined_definitions;
+    for (int i = 0; i < 2; i++) {
+        for (std::pair<const std::string, IrInstruction*>& definition : branch_definitions[i]) {
+            Definitions::iterator other = branch_definitions[1 - i].find(definition.first);
+            if (other == branch_definitions[1 - i].end() || other->second == nullptr || definition.second == nullptr) joined_definitions[definition.first] = nullptr;
+            else if (other->second == definition.second) joined_definitions[definition.first] = definition.second;
+            else if (i == 0) {
+                IrInstruction* phi = function->new_instruction(IR_PHI, join_block);
+                phi->variable_name = definition.first;
+                phi->operands = { definition.second, other->second };
+                phi->incoming_blocks = { branch_ends[0], branch_ends[1] };
+                joined_definitions[definition.first] = phi;
+            }
+        }
+    }
+    definitions = joined_definitions;
+    return true;
+}
+
+// Variables that exist before the loop and are assigned in the body get a
+// phi in the header. Variables first assigned in the body belong to the
+// iteration's scope and are gone once the loop exits.
+bool IrBuilder::build_while(WhileNode* node, IrRegion& region, Definitions& definitions) {
+    if (node->preheader != nullptr) return false;
+
+    IrBasicBlock* preceding_block = current_block;
+    IrBasicBlock* header = function->new_block();
+    preceding_block->successors.push_back(header);
+    current_block = header;
+
+    std::map<std::string, int> assignment_counts;
+    collect_assignments(node->body, assignment_counts);
+    std::vector<IrInstruction*> phis;
+    for (std::pair<const std::string, IrInstruction*>& definition : definitions) {
+        if (definition.second == nullptr || !assignment_counts.count(definition.first)) continue;
+        IrInstruction* phi = function->new_instruction(IR_PHI, header);
+        phi->variable_name = definition.first;
+        phi->operands.push_back(definition.second);
+        phi->incoming_blocks.push_back(preceding_block);
+        definition.second = phi;
+        phis.push_back(phi);
+    }
+
+    IrInstruction* condition = build_value(node->condition, definitions);
+    if (condition == nullptr) return false;
+    header->branch_condition = condition;
+
+    IrRegionItem item { IrRegionItem::WHILE, header, std::make_unique<IrRegion>(), nullptr };
+    IrRegion* body_region = item.first.get();
+    region.items.push_back(std::move(item));
+
+    Definitions body_definitions = definitions;
+    header->successors.push_back(start_block(*body_region));
+    terminated = false;
+    if (!build_statement(node->body, *body_region, body_definitions)) return false;
+    if (!terminated) {
+        current_block->successors.push_back(header);
+        for (IrInstruction* phi : phis) {
+            IrInstruction* value = body_definitions[phi->variable_name];
+            if (value == nullptr) return false;
+            phi->operands.push_back(value);
+            phi->incoming_blocks.push_back(current_block);
+        }
+    }
+
+    terminated = false;
+    header->successors.push_back(start_block(region));
+    return true;
+}
+
+bool IrBuilder::build_statement(SyntaxTreeNode* node, IrRegion& region, Definitions& definitions) {
+    switch (node->node_type) {
+        case SyntaxTreeNodeType::STATEMENT_SEQUENCE:
+            for (SyntaxTreeNode* statement : static_cast<StatementSequenceNode*>(node)->statements) {
+                if (terminated) break;
+                if (!build_statement(statement, region, definitions)) return false;
+            }
+            return true;
+        case SyntaxTreeNodeType::EMPTY:
+            return true;
+        case SyntaxTreeNodeType::ASSIGNMENT: {
+            AssignmentNode* assignment_node = static_cast<AssignmentNode*>(node);
+            IrInstruction* value = build_value(assignment_node->value, definitions);
+            if (value == nullptr) return false;
+            if (assignment_node->value->node_type == SyntaxTreeNodeType::OPERAND) {
+                IrInstruction* copy = function->new_instruction(IR_COPY, current_block);
+                copy->operands.push_back(value);
+                copy->variable_name = assignment_node->variable_name;
+                value = copy;
+            }
+            definitions[assignment_node->variable_name] = value;
+            return true;
+        }
+        case SyntaxTreeNodeType::PRINT:
+        case SyntaxTreeNodeType::RETURN: {
+            SyntaxTreeNode* value_node = node->node_type == SyntaxTreeNodeType::PRINT ? static_cast<PrintNode*>(node)->value : static_cast<ReturnNode*>(node)->value;
+            IrInstruction* value = build_value(value_node, definitions);
+            if (value == nullptr) return false;
+            IrInstruction* instruction = function->new_instruction(node->node_type == SyntaxTreeNodeType::PRINT ? IR_PRINT : IR_RETURN, current_block);
+            instruction->operands.push_back(value);
+            if (node->node_type == SyntaxTreeNodeType::RETURN) terminated = true;
+            return true;
+        }
+        case SyntaxTreeNodeType::FUNCTION_CALL:
+        case SyntaxTreeNodeType::BUILTIN_CALL:
+            return build_value(node, definitions) != nullptr;
+        case SyntaxTreeNodeType::IF_ELSE:
+            return build_if_else(static_cast<IfElseNode*>(node), region, definitions);
+        case SyntaxTreeNodeType::WHILE:
+            return build_while(static_cast<WhileNode*>(node), region, definitions);
+        default:
+            return false;
+    }
+}
+
+// Returns null when the body uses something the IR cannot represent.
+std::unique_ptr<IrFunction> IrBuilder::build(const std::string& name, const std::vector<std::string>& parameters, SyntaxTreeNode* body) {
+    std::unique_ptr<IrFunction> ir_function = std::make_unique<IrFunction>(name, parameters);
+    function = ir_function.get();
+    terminated = false;
+    start_block(function->body);
+
+    Definitions definitions;
+    for (const std::string& parameter : parameters) {
+        IrInstruction* instruction = function->new_instruction(IR_PARAMETER, current_block);
+        instruction->variable_name = parameter;
+        definitions[parameter] = instruction;
+    }
+
+    if (!build_statement(body, function->body, definitions)) return nullptr;
+    return ir_function;
+}
@@ -0,0 +1,34 @@
+#ifndef IR_BUILDER_H
+#define IR_BUILDER_H
+
+#include "ir.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+
+// Builds SSA form directly from the structured syntax tree, tracking the
+// value each variable holds as statements are visited. If blocks share
+// their enclosing scope, so a variable first assigned on only one side of
+// an if may or may not exist after it; reading such a variable, or one
+// that was never assigned, makes the body unsupported.
+class IrBuilder {
+private:
+    // A null value means the variable may not exist at this point.
+    using Definitions = std::map<std::string, IrInstruction*>;
+
+    IrFunction* function;
+    IrBasicBlock* current_block;
+    bool terminated;
+
+    IrBasicBlock* start_block(IrRegion& region);
+    IrInstruction* build_value(SyntaxTreeNode* node, Definitions& definitions);
+    bool build_if_else(IfElseNode* node, IrRegion& region, Definitions& definitions);
+    bool build_while(WhileNode* node, IrRegion& region, Definitions& definitions);
+    bool build_statement(SyntaxTreeNode* node, IrRegion& region, Definitions& definitions);
+
+public:
+    std::unique_ptr<IrFunction> build(const std::string& name, const std::vector<std::string>& parameters, SyntaxTreeNode* body);
+};
+
+#endif
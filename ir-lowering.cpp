@@ -0,0 +1,398 @@
+#include "ir-lowering.hpp"
+#include <algorithm>
+
+void IrLowering::record_use(IrInstruction* value, IrBasicBlock* block, int position, IrInstruction* user) {
+    Use& use = uses[value];
+    use.count++;
+    use.block = block;
+    use.position = position;
+    use.user = user;
+}
+
+void IrLowering::find_uses(IrFunction& function) {
+    for (IrBasicBlock* block : function.get_blocks()) {
+        for (int i = 0; i < (int) block->instructions.size(); i++) {
+            IrInstruction* instruction = block->instructions[i];
+            for (int j = 0; j < (int) instruction->operands.size(); j++) {
+                if (instruction->opcode == IR_PHI) {
+                    IrBasicBlock* incoming_block = instruction->incoming_blocks[j];
+                    record_use(instruction->operands[j], incoming_block, incoming_block->instructions.size(), instruction);
+                } else record_use(instruction->operands[j], block, i, instruction);
+            }
+        }
+        if (block->branch_condition != nullptr) record_use(block->branch_condition, block, block->instructions.size(), nullptr);
+    }
+}
+
+void IrLowering::find_loops(IrRegion& region, std::vector<IrBasicBlock*>& loops, IrBasicBlock* body_of) {
+    for (IrRegionItem& item : region.items) {
+        if (item.kind == IrRegionItem::BLOCK) {
+            enclosing_loops[item.block] = loops;
+            if (body_of != nullptr) loop_body_blocks[item.block] = body_of;
+        } else if (item.kind == IrRegionItem::IF) {
+            find_loops(*item.first, loops, nullptr);
+            find_loops(*item.second, loops, nullptr);
+        } else {
+            loop_headers.insert(item.block);
+            loops.push_back(item.block);
+            enclosing_loops[item.block] = loops;
+            find_loops(*item.first, loops, item.block);
+            loops.pop_back();
+        }
+    }
+}
+
+bool IrLowering::is_loop_invariant(IrInstruction* value, IrBasicBlock* header) {
+    if (value->opcode == IR_CONSTANT || value->opcode == IR_PARAMETER) return true;
+    std::vector<IrBasicBlock*>& loops = enclosing_loops[value->block];
+    if (std::find(loops.begin(), loops.end(), header) == loops.end()) return true;
+    bool is_pure_builtin_call = value->opcode == IR_BUILTIN_CALL && value->builtin->is_pure;
+    if (value->opcode != IR_BINARY_OPERATION && !is_pure_builtin_call) return false;
+    for (IrInstruction* operand : value->operands) {
+        if (!is_loop_invariant(operand, header)) return false;
+    }
+    return true;
+}
+
+// Decides which values are folded into their user. Visiting the block
+// backwards means a value's user has already been placed, so the value is
+// known to be evaluated where the outermost expression containing it is.
+// Values that can fail and calls are only moved if no effect lies in
+// between. A loop condition is evaluated once per iteration, so every
+// value computed in a loop header has to fold into it. A loop invariant
+// value in a loop body stays a statement of its own, which lets loop
+// invariant code motion hoist it.
+bool IrLowering::choose_folded_values(IrBasicBlock* block, bool is_loop_header) {
+    std::vector<IrInstruction*>& instructions = block->instructions;
+    std::vector<int> effects_before(instructions.size() + 1, 0);
+    for (int i = 0; i < (int) instructions.size(); i++) effects_before[i + 1] = effects_before[i] + (instructions[i]->has_side_effects() ? 1 : 0);
+
+    for (int i = instructions.size() - 1; i >= 0; i--) {
+        IrInstruction* value = instructions[i];
+        if (value->opcode == IR_CONSTANT || value->opcode == IR_PARAMETER || value->opcode == IR_PHI) continue;
+        if (value->opcode == IR_PRINT || value->opcode == IR_RETURN) {
+            if (is_loop_header) return false;
+            continue;
+        }
+
+        std::map<IrInstruction*, Use>::iterator use = uses.find(value);
+        bool can_fold = use != uses.end() && use->second.count == 1 && use->second.block == block;
+        if (can_fold) {
+            IrInstruction* user = use->second.user;
+            int evaluation_position = user != nullptr && folded.count(user) ? evaluation_positions[user] : use->second.position;
+            bool effects_between = effects_before[evaluation_position] != effects_before[i + 1];
+            if (value->has_side_effects()) {
+                bool user_is_statement = user != nullptr && (user->opcode == IR_PRINT || user->opcode == IR_RETURN || user->opcode == IR_PHI);
+                can_fold = user_is_statement && !effects_between;
+            } else if (value->may_fail()) can_fold = !effects_between;
+            if (can_fold && loop_body_blocks.count(block)) {
+                IrBasicBlock* header = loop_body_blocks[block];
+                bool user_is_invariant = user != nullptr && is_loop_invariant(user, header);
+                if (is_loop_invariant(value, header) && !user_is_invariant) can_fold = false;
+            }
+            if (can_fold) {
+                folded.insert(value);
+                evaluation_positions[value] = evaluation_position;
+            }
+        }
+        if (!can_fold && is_loop_header) return false;
+    }
+    return true;
+}
+
+// Whether the lowered tree assigns the instruction's value to a variable.
+// Parameters are assigned by the call and phis by their predecessors.
+bool IrLowering::defines_variable(IrInstruction* instruction) {
+    switch (instruction->opcode) {
+        case IR_CONSTANT:
+        case IR_PRINT:
+        case IR_RETURN:
+            return false;
+        case IR_PARAMETER:
+        case IR_PHI:
+            return true;
+        default:
+            return !folded.count(instruction) && (uses.count(instruction) || !instruction->has_side_effects());
+    }
+}
+
+// The variables read when the value is evaluated where it is used.
+void IrLowering::collect_reads(IrInstruction* value, std::set<IrInstruction*>& reads) {
+    if (value->opcode == IR_CONSTANT) return;
+    if (!folded.count(value)) {
+        reads.insert(value);
+        return;
+    }
+    for (IrInstruction* operand : value->operands) collect_reads(operand, reads);
+}
+
+void IrLowering::add_interferences(IrInstruction* definition, std::set<IrInstruction*>& live) {
+    for (IrInstruction* value : live) {
+        if (value == definition) continue;
+        interferences.insert({ definition, value });
+        interferences.insert({ value, definition });
+    }
+}
+
+// Walks the block backwards from the values live at its end and returns
+// the values live at its start. Phis and parameters are all defined at the
+// start of their block, at once.
+std::set<IrInstruction*> IrLowering::walk_block(IrBasicBlock* block, std::set<IrInstruction*> live, bool record_interferences) {
+    if (block->branch_condition != nullptr) collect_reads(block->branch_condition, live);
+
+    std::vector<IrInstruction*> entry_definitions;
+    for (int i = block->instructions.size() - 1; i >= 0; i--) {
+        IrInstruction* instruction = block->instructions[i];
+        if (instruction->opcode == IR_CONSTANT || folded.count(instruction)) continue;
+        if (instruction->opcode == IR_PHI || instruction->opcode == IR_PARAMETER) {
+            entry_definitions.push_back(instruction);
+            continue;
+        }
+        if (defines_variable(instruction)) {
+            live.erase(instruction);
+            if (record_interferences) add_interferences(instruction, live);
+        }
+        for (IrInstruction* operand : instruction->operands) collect_reads(operand, live);
+    }
+
+    for (IrInstruction* definition : entry_definitions) live.erase(definition);
+    if (record_interferences) {
+        std::set<IrInstruction*> defined_together(entry_definitions.begin(), entry_definitions.end());
+        for (IrInstruction* definition : entry_definitions) {
+            add_interferences(definition, live);
+            add_interferences(definition, defined_together);
+        }
+    }
+    return live;
+}
+
+// Phi operands are live at the end of the predecessor they arrive from,
+// not at the start of the phi's block.
+void IrLowering::find_interferences(IrFunction& function) {
+    std::vector<IrBasicBlock*> blocks = function.get_blocks();
+    std::map<IrBasicBlock*, std::set<IrInstruction*>> live_in;
+    std::map<IrBasicBlock*, std::set<IrInstruction*>> live_out;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = blocks.size() - 1; i >= 0; i--) {
+            IrBasicBlock* block = blocks[i];
+            std::set<IrInstruction*> live = std::set<IrInstruction*>();
+            for (IrBasicBlock* successor : block->successors) {
+                live.insert(live_in[successor].begin(), live_in[successor].end());
+                for (IrInstruction* phi : successor->instructions) {
+                    if (phi->opcode != IR_PHI) break;
+                    for (int j = 0; j < (int) phi->operands.size(); j++) {
+                        if (phi->incoming_blocks[j] == block) collect_reads(phi->operands[j], live);
+                    }
+                }
+            }
+            std::set<IrInstruction*> block_live_in = walk_block(block, live, false);
+            if (live != live_out[block] || block_live_in != live_in[block]) changed = true;
+            live_out[block] = live;
+            live_in[block] = block_live_in;
+        }
+    }
+
+    for (IrBasicBlock* block : blocks) walk_block(block, live_out[block], true);
+}
+
+IrInstruction* IrLowering::find_variable_class(IrInstruction* value) {
+    std::map<IrInstruction*, IrInstruction*>::iterator parent = variable_classes.find(value);
+    if (parent == variable_classes.end()) return value;
+    IrInstruction* root = find_variable_class(parent->second);
+    parent->second = root;
+    return root;
+}
+
+bool IrLowering::variable_classes_interfere(IrInstruction* first, IrInstruction* second) {
+    std::vector<IrInstruction*> first_members = variable_class_members.count(first) ? variable_class_members[first] : std::vector<IrInstruction*> { first };
+    std::vector<IrInstruction*> second_members = variable_class_members.count(second) ? variable_class_members[second] : std::vector<IrInstruction*> { second };
+    for (IrInstruction* first_member : first_members) {
+        for (IrInstruction* second_member : second_members) {
+            if (interferences.count({ first_member, second_member })) return true;
+        }
+    }
+    return false;
+}
+
+void IrLowering::coalesce_phis(IrFunction& function) {
+    for (IrBasicBlock* block : function.get_blocks()) {
+        for (IrInstruction* phi : block->instructions) {
+            if (phi->opcode != IR_PHI) break;
+            for (IrInstruction* operand : phi->operands) {
+                if (!defines_variable(operand)) continue;
+                IrInstruction* phi_class = find_variable_class(phi);
+                IrInstruction* operand_class = find_variable_class(operand);
+                if (phi_class == operand_class || variable_classes_interfere(phi_class, operand_class)) continue;
+
+                std::vector<IrInstruction*>& members = variable_class_members[phi_class];
+                if (members.empty()) members.push_back(phi_class);
+                if (variable_class_members.count(operand_class)) members.insert(members.end(), variable_class_members[operand_class].begin(), variable_class_members[operand_class].end());
+                else members.push_back(operand_class);
+                variable_class_members.erase(operand_class);
+                variable_classes[operand_class] = phi_class;
+            }
+        }
+    }
+}
+
+// A class containing a parameter keeps the parameter's name. Other names
+// start with a character identifiers cannot contain.
+std::string IrLowering::get_variable_name(IrInstruction* value) {
+    IrInstruction* variable_class = find_variable_class(value);
+    if (variable_class_members.count(variable_class)) {
+        for (IrInstruction* member : variable_class_members[variable_class]) {
+            if (member->opcode == IR_PARAMETER) return member->variable_name;
+        }
+    }
+    if (variable_class->opcode == IR_PARAMETER) return variable_class->variable_name;
+    return "%" + std::to_string(variable_class->id);
+}
+
+SyntaxTreeNode* IrLowering::lower_operand(IrInstruction* value) {
+    if (value->opcode == IR_CONSTANT) return new OperandNode(LITERAL, value->constant);
+    if (folded.count(value)) return lower_expression(value);
+    return new OperandNode(IDENTIFIER, get_variable_name(value));
+}
+
+SyntaxTreeNode* IrLowering::lower_expression(IrInstruction* value) {
+    switch (value->opcode) {
+        case IR_BINARY_OPERATION:
+            return new BinaryOperationNode(value->operation, lower_operand(value->operands[0]), lower_operand(value->operands[1]));
+        case IR_BUILTIN_CALL: {
+            std::vector<SyntaxTreeNode*> arguments;
+            for (IrInstruction* operand : value->operands) arguments.push_back(lower_operand(operand));
+            return new BuiltinCallNode(value->builtin, arguments);
+        }
+        case IR_FUNCTION_CALL: {
+            std::map<std::string, SyntaxTreeNode*> arguments;
+            for (int i = 0; i < (int) value->operands.size(); i++) arguments[value->argument_names[i]] = lower_operand(value->operands[i]);
+            return new FunctionNode(value->function, arguments);
+        }
+        case IR_COPY:
+            return lower_operand(value->operands[0]);
+        default:
+            return lower_operand(value);
+    }
+}
+
+// The copies into a successor's phis happen at once, so a copy is only
+// emitted once no other pending copy still reads its variable. A cycle is
+// broken by evaluating one copy into a temporary first.
+void IrLowering::lower_phi_copies(IrBasicBlock* block, std::vector<SyntaxTreeNode*>& statements) {
+    struct PendingCopy {
+        IrInstruction* variable_class;
+        SyntaxTreeNode* value;
+        std::set<IrInstruction*> read_classes;
+    };
+
+    std::vector<PendingCopy> pending;
+    for (IrBasicBlock* successor : block->successors) {
+        for (IrInstruction* phi : successor->instructions) {
+            if (phi->opcode != IR_PHI) break;
+            for (int i = 0; i < (int) phi->operands.size(); i++) {
+                IrInstruction* operand = phi->operands[i];
+                if (phi->incoming_blocks[i] != block) continue;
+                if (defines_variable(operand) && find_variable_class(operand) == find_variable_class(phi)) continue;
+
+                PendingCopy copy { find_variable_class(phi), lower_operand(operand), std::set<IrInstruction*>() };
+                std::set<IrInstruction*> reads;
+                collect_reads(operand, reads);
+                for (IrInstruction* read : reads) copy.read_classes.insert(find_variable_class(read));
+                pending.push_back(copy);
+            }
+        }
+    }
+
+    while (!pending.empty()) {
+        int ready = -1;
+        for (int i = 0; i < (int) pending.size() && ready == -1; i++) {
+            bool is_read = false;
+            for (int j = 0; j < (int) pending.size(); j++) {
+                if (j != i && pending[j].read_classes.count(pending[i].variable_class)) is_read = true;
+            }
+            if (!is_read) ready = i;
+        }
+
+        if (ready == -1) {
+            std::string temporary = "%t" + std::to_string(temporary_count++);
+            statements.push_back(new AssignmentNode(temporary, pending[0].value));
+            pending[0].value = new OperandNode(IDENTIFIER, temporary);
+            pending[0].read_classes.clear();
+            continue;
+        }
+        statements.push_back(new AssignmentNode(get_variable_name(pending[ready].variable_class), pending[ready].value));
+        pending.erase(pending.begin() + ready);
+    }
+}
+
+void IrLowering::lower_block(IrBasicBlock* block, std::vector<SyntaxTreeNode*>& statements) {
+    for (IrInstruction* instruction : block->instructions) {
+        switch (instruction->opcode) {
+            case IR_CONSTANT:
+            case IR_PARAMETER:
+            case IR_PHI:
+                break;
+            case IR_PRINT:
+                statements.push_back(new PrintNode(lower_operand(instruction->operands[0])));
+                break;
+            case IR_RETURN:
+                statements.push_back(new ReturnNode(lower_operand(instruction->operands[0])));
+                break;
+            default:
+                if (defines_variable(instruction)) statements.push_back(new AssignmentNode(get_variable_name(instruction), lower_expression(instruction)));
+                else if (!folded.count(instruction)) statements.push_back(lower_expression(instruction));
+                break;
+        }
+    }
+    lower_phi_copies(block, statements);
+}
+
+SyntaxTreeNode* IrLowering::lower_region(IrRegion& region) {
+    std::vector<SyntaxTreeNode*> statements;
+    for (int i = 0; i < (int) region.items.size(); i++) {
+        IrRegionItem& item = region.items[i];
+        switch (item.kind) {
+            case IrRegionItem::BLOCK:
+                lower_block(item.block, statements);
+                break;
+            case IrRegionItem::IF: {
+                SyntaxTreeNode* condition = lower_operand(region.items[i - 1].block->branch_condition);
+                statements.push_back(new IfElseNode(condition, lower_region(*item.first), lower_region(*item.second)));
+                break;
+            }
+            case IrRegionItem::WHILE:
+                statements.push_back(new WhileNode(lower_operand(item.block->branch_condition), lower_region(*item.first)));
+                break;
+        }
+    }
+    if (statements.empty()) return new EmptyNode();
+    return new StatementSequenceNode(statements);
+}
+
+// Returns null when a loop condition cannot be expressed as a single
+// expression.
+SyntaxTreeNode* IrLowering::lower(IrFunction& function) {
+    uses.clear();
+    enclosing_loops.clear();
+    loop_headers.clear();
+    loop_body_blocks.clear();
+    folded.clear();
+    evaluation_positions.clear();
+    interferences.clear();
+    variable_classes.clear();
+    variable_class_members.clear();
+    temporary_count = 0;
+
+    find_uses(function);
+    std::vector<IrBasicBlock*> loops;
+    find_loops(function.body, loops, nullptr);
+    for (IrBasicBlock* block : function.get_blocks()) {
+        if (!choose_folded_values(block, loop_headers.count(block))) return nullptr;
+    }
+    find_interferences(function);
+    coalesce_phis(function);
+    return lower_region(function.body);
+}
@@ -0,0 +1,66 @@
+#ifndef IR_LOWERING_H
+#define IR_LOWERING_H
+
+#include "ir.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+
+// Turns SSA form back into a syntax tree. A value used once, later in the
+// same block, is folded into the expression that uses it instead of being
+// stored in a variable. Other values get a variable, and a phi becomes
+// assignments to its variable at the end of each predecessor. A phi shares
+// its variable with its operands wherever their live ranges do not
+// overlap, which makes most of those assignments unnecessary.
+class IrLowering {
+private:
+    struct Use {
+        int count;
+        IrBasicBlock* block;
+        // Position of the use within its block. Branch conditions and phi
+        // copies are used after the last instruction.
+        int position;
+        IrInstruction* user;
+    };
+
+    std::map<IrInstruction*, Use> uses;
+    // The headers of the loops each block is part of, innermost last. A
+    // header is part of its own loop.
+    std::map<IrBasicBlock*, std::vector<IrBasicBlock*>> enclosing_loops;
+    std::set<IrBasicBlock*> loop_headers;
+    // Blocks directly in a loop body, outside any if, by loop header.
+    std::map<IrBasicBlock*, IrBasicBlock*> loop_body_blocks;
+    std::set<IrInstruction*> folded;
+    std::map<IrInstruction*, int> evaluation_positions;
+    std::set<std::pair<IrInstruction*, IrInstruction*>> interferences;
+    // Values sharing a variable, as a union find forest.
+    std::map<IrInstruction*, IrInstruction*> variable_classes;
+    std::map<IrInstruction*, std::vector<IrInstruction*>> variable_class_members;
+    int temporary_count;
+
+    void record_use(IrInstruction* value, IrBasicBlock* block, int position, IrInstruction* user);
+    void find_uses(IrFunction& function);
+    void find_loops(IrRegion& region, std::vector<IrBasicBlock*>& loops, IrBasicBlock* body_of);
+    bool is_loop_invariant(IrInstruction* value, IrBasicBlock* header);
+    bool choose_folded_values(IrBasicBlock* block, bool is_loop_header);
+    bool defines_variable(IrInstruction* instruction);
+    void collect_reads(IrInstruction* value, std::set<IrInstruction*>& reads);
+    void add_interferences(IrInstruction* definition, std::set<IrInstruction*>& live);
+    std::set<IrInstruction*> walk_block(IrBasicBlock* block, std::set<IrInstruction*> live, bool record_interferences);
+    void find_interferences(IrFunction& function);
+    IrInstruction* find_variable_class(IrInstruction* value);
+    bool variable_classes_interfere(IrInstruction* first, IrInstruction* second);
+    void coalesce_phis(IrFunction& function);
+    std::string get_variable_name(IrInstruction* value);
+    SyntaxTreeNode* lower_operand(IrInstruction* value);
+    SyntaxTreeNode* lower_expression(IrInstruction* value);
+    void lower_phi_copies(IrBasicBlock* block, std::vector<SyntaxTreeNode*>& statements);
+    void lower_block(IrBasicBlock* block, std::vector<SyntaxTreeNode*>& statements);
+    SyntaxTreeNode* lower_region(IrRegion& region);
+
+public:
+    SyntaxTreeNode* lower(IrFunction& function);
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "ir-passes.hpp"
+#include <set>
+#include <algorithm>
+
+void CopyPropagation::run(IrFunction& function) {
+    bool changed = true;
+    while (changed) {
+        std::map<IrInstruction*, IrInstruction*> replacements;
+        for (IrBasicBlock* block : function.get_blocks()) {
+            for (IrInstruction* instruction : block->instructions) {
+                if (instruction->opcode == IR_COPY) replacements[instruction] = instruction->operands[0];
+                if (instruction->opcode != IR_PHI) continue;
+
+                std::set<IrInstruction*> values;
+                for (IrInstruction* operand : instruction->operands) {
+                    if (operand != instruction) values.insert(operand);
+                }
+                if (values.size() == 1) replacements[instruction] = *values.begin();
+            }
+        }
+        function.replace_uses(replacements);
+        changed = !replacements.empty();
+    }
+}
+
+static bool is_commutative(BinaryOperation operation) {
+    return operation == BinaryOperation::ADD || operation == BinaryOperation::MULTIPLY || operation == BinaryOperation::EQUAL || operation == BinaryOperation::NOT_EQUAL || operation == BinaryOperation::AND || operation == BinaryOperation::OR;
+}
+
+IrInstruction* GlobalValueNumbering::find_value(ValueKey& key) {
+    for (int i = scopes.size() - 1; i >= 0; i--) {
+        std::map<ValueKey, IrInstruction*>::iterator value = scopes[i].find(key);
+        if (value != scopes[i].end()) return value->second;
+    }
+    return nullptr;
+}
+
+void GlobalValueNumbering::number_block(IrBasicBlock* block, bool is_loop_header) {
+    for (IrInstruction* instruction : block->instructions) {
+        for (IrInstruction*& operand : instruction->operands) {
+            while (replacements.count(operand)) operand = replacements[operand];
+        }
+
+        bool is_pure_builtin_call = instruction->opcode == IR_BUILTIN_CALL && instruction->builtin->is_pure;
+        if (instruction->opcode != IR_CONSTANT && instruction->opcode != IR_BINARY_OPERATION && instruction->opcode != IR_PHI && !is_pure_builtin_call) continue;
+
+        std::vector<IrInstruction*> operands = instruction->operands;
+        if (instruction->opcode == IR_BINARY_OPERATION && is_commutative(instruction->operation) && operands[0]->id > operands[1]->id) std::swap(operands[0], operands[1]);
+        // Phis are only equal to phis in the same block.
+        int phi_block = instruction->opcode == IR_PHI ? block->id : -1;
+        ValueKey key { instruction->opcode, instruction->operation, instruction->constant, instruction->builtin, phi_block, operands };
+
+        IrInstruction* value = find_value(key);
+        if (value != nullptr) replacements[instruction] = value;
+        else if (!is_loop_header || instruction->opcode == IR_PHI) scopes.back()[key] = instruction;
+    }
+}
+
+void GlobalValueNumbering::number_region(IrRegion& region) {
+    for (IrRegionItem& item : region.items) {
+        if (item.kind == IrRegionItem::BLOCK) number_block(item.block, false);
+        else if (item.kind == IrRegionItem::WHILE) number_block(item.block, true);
+
+        if (item.first != nullptr) {
+            scopes.emplace_back();
+            number_region(*item.first);
+            scopes.pop_back();
+        }
+        if (item.second != nullptr) {
+            scopes.emplace_back();
+            number_region(*item.second);
+            scopes.pop_back();
+        }
+    }
+}
+
+// Walks regions in program order with a scope of known values per region,
+// so a value is only visible to blocks it dominates.
+void GlobalValueNumbering::run(IrFunction& function) {
+    scopes.clear();
+    replacements.clear();
+    scopes.emplace_back();
+    number_region(function.body);
+    function.replace_uses(replacements);
+}
+
+void DeadStoreElimination::run(IrFunction& function) {
+    std::vector<IrBasicBlock*> blocks = function.get_blocks();
+    std::set<IrInstruction*> live;
+    std::vector<IrInstruction*> worklist;
+    for (IrBasicBlock* block : blocks) {
+        for (IrInstruction* instruction : block->instructions) {
+            if (instruction->has_side_effects() || instruction->may_fail()) worklist.push_back(instruction);
+        }
+        if (block->branch_condition != nullptr) worklist.push_back(block->branch_condition);
+    }
+
+    while (!worklist.empty()) {
+        IrInstruction* instruction = worklist.back();
+        worklist.pop_back();
+        if (!live.insert(instruction).second) continue;
+        for (IrInstruction* operand : instruction->operands) worklist.push_back(operand);
+    }
+
+    for (IrBasicBlock* block : blocks) {
+        std::vector<IrInstruction*>& instructions = block->instructions;
+        instructions.erase(std::remove_if(instructions.begin(), instructions.end(), [&live](IrInstruction* instruction) { return !live.count(instruction); }), instructions.end());
+    }
+}
+
+void IrPassManager::add_pass(std::unique_ptr<IrPass> pass) {
+    passes.push_back(std::move(pass));
+}
+
+void IrPassManager::run(IrFunction& function) {
+    if (dump_stream != nullptr) *dump_stream << "; " << function.name << " after building" << std::endl << function << std::endl;
+    for (std::unique_ptr<IrPass>& pass : passes) {
+        pass->run(function);
+        if (dump_stream != nullptr) *dump_stream << "; " << function.name << " after " << pass->get_name() << std::endl << function << std::endl;
+    }
+}
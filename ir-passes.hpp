@@ -0,0 +1,68 @@
+#ifndef IR_PASSES_H
+#define IR_PASSES_H
+
+#include "ir.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <iostream>
+
+class IrPass {
+public:
+    virtual ~IrPass() {}
+    virtual std::string get_name() = 0;
+    virtual void run(IrFunction& function) = 0;
+};
+
+// Replaces copies with their sources and phis whose operands are all the
+// same value with that value.
+class CopyPropagation : public IrPass {
+public:
+    std::string get_name() { return "copy-propagation"; }
+    void run(IrFunction& function);
+};
+
+// Replaces a pure instruction with an earlier one computing the same
+// value, as long as the earlier one dominates it. Values computed in a
+// loop header are never reused, since they must stay part of the loop
+// condition when lowered.
+class GlobalValueNumbering : public IrPass {
+private:
+    using ValueKey = std::tuple<int, int, int, const Builtin*, int, std::vector<IrInstruction*>>;
+    std::vector<std::map<ValueKey, IrInstruction*>> scopes;
+    std::map<IrInstruction*, IrInstruction*> replacements;
+
+    IrInstruction* find_value(ValueKey& key);
+    void number_block(IrBasicBlock* block, bool is_loop_header);
+    void number_region(IrRegion& region);
+
+public:
+    std::string get_name() { return "global-value-numbering"; }
+    void run(IrFunction& function);
+};
+
+// Removes instructions whose value is never used and which have no
+// effect. Every assignment in the lowered tree comes from an instruction,
+// so this removes the stores of temporaries that are never read.
+class DeadStoreElimination : public IrPass {
+public:
+    std::string get_name() { return "dead-store-elimination"; }
+    void run(IrFunction& function);
+};
+
+// Runs passes in order, optionally printing the function before the first
+// pass and after each one.
+class IrPassManager {
+private:
+    std::vector<std::unique_ptr<IrPass>> passes;
+    std::ostream* dump_stream;
+
+public:
+    IrPassManager(std::ostream* dump_stream = nullptr) : dump_stream(dump_stream) {}
+    void add_pass(std::unique_ptr<IrPass> pass);
+    void run(IrFunction& function);
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "ir.hpp"
+
+bool IrInstruction::has_side_effects() {
+    switch (opcode) {
+        case IR_PRINT:
+        case IR_RETURN:
+        case IR_FUNCTION_CALL:
+            return true;
+        case IR_BUILTIN_CALL:
+            return !builtin->is_pure;
+        default:
+            return false;
+    }
+}
+
+// Whether evaluating the instruction can crash or fail to terminate.
+bool IrInstruction::may_fail() {
+    if (opcode == IR_FUNCTION_CALL) return true;
+    if (opcode != IR_BINARY_OPERATION) return false;
+    if (operation != BinaryOperation::DIVIDE && operation != BinaryOperation::MOD) return false;
+    IrInstruction* divisor = operands[1];
+    return divisor->opcode != IR_CONSTANT || divisor->constant == 0 || divisor->constant == -1;
+}
+
+IrInstruction* IrFunction::new_instruction(IrOpcode opcode, IrBasicBlock* block) {
+    instructions.push_back(std::make_unique<IrInstruction>(instructions.size(), opcode, block));
+    IrInstruction* instruction = instructions.back().get();
+    block->instructions.push_back(instruction);
+    return instruction;
+}
+
+IrBasicBlock* IrFunction::new_block() {
+    blocks.push_back(std::make_unique<IrBasicBlock>(blocks.size()));
+    return blocks.back().get();
+}
+
+static void collect_blocks(IrRegion& region, std::vector<IrBasicBlock*>& blocks) {
+    for (IrRegionItem& item : region.items) {
+        if (item.kind == IrRegionItem::BLOCK || item.kind == IrRegionItem::WHILE) blocks.push_back(item.block);
+        if (item.first != nullptr) collect_blocks(*item.first, blocks);
+        if (item.second != nullptr) collect_blocks(*item.second, blocks);
+    }
+}
+
+// Blocks in program order, so each block comes after the blocks that
+// dominate it.
+std::vector<IrBasicBlock*> IrFunction::get_blocks() {
+    std::vector<IrBasicBlock*> ordered_blocks;
+    collect_blocks(body, ordered_blocks);
+    return ordered_blocks;
+}
+
+static IrInstruction* resolve(IrInstruction* instruction, std::map<IrInstruction*, IrInstruction*>& replacements) {
+    std::map<IrInstruction*, IrInstruction*>::iterator replacement = replacements.find(instruction);
+    while (replacement != replacements.end()) {
+        instruction = replacement->second;
+        replacement = replacements.find(instruction);
+    }
+    return instruction;
+}
+
+// Rewrites every use of a replaced instruction and removes the replaced
+// instructions from their blocks.
+void IrFunction::replace_uses(std::map<IrInstruction*, IrInstruction*>& replacements) {
+    for (IrBasicBlock* block : get_blocks()) {
+        std::vector<IrInstruction*> remaining;
+        for (IrInstruction* instruction : block->instructions) {
+            if (replacements.count(instruction)) continue;
+            for (IrInstruction*& operand : instruction->operands) operand = resolve(operand, replacements);
+            remaining.push_back(instruction);
+        }
+        block->instructions = remaining;
+        if (block->branch_condition != nullptr) block->branch_condition = resolve(block->branch_condition, replacements);
+    }
+}
+
+static std::string get_opcode_string(IrOpcode opcode) {
+    switch (opcode) {
+        case IR_CONSTANT: return "constant";
+        case IR_PARAMETER: return "parameter";
+        case IR_COPY: return "copy";
+        case IR_PHI: return "phi";
+        case IR_BINARY_OPERATION: return "binary";
+        case IR_BUILTIN_CALL: return "builtin";
+        case IR_FUNCTION_CALL: return "call";
+        case IR_PRINT: return "print";
+        case IR_RETURN: return "return";
+    }
+    return "?";
+}
+
+static void print_instruction(std::ostream& o, IrInstruction* instruction) {
+    o << "    ";
+    if (instruction->opcode != IR_PRINT && instruction->opcode != IR_RETURN) o << "%" << instruction->id << " = ";
+
+    switch (instruction->opcode) {
+        case IR_CONSTANT:
+            o << instruction->constant;
+            break;
+        case IR_PARAMETER:
+            o << "parameter " << instruction->variable_name;
+            break;
+        case IR_BINARY_OPERATION:
+            o << "%" << instruction->operands[0]->id << " " << get_binary_operation_string(instruction->operation) << " %" << instruction->operands[1]->id;
+            break;
+        case IR_PHI:
+            o << "phi";
+            for (int i = 0; i < (int) instruction->operands.size(); i++) {
+                o << (i == 0 ? " " : ", ") << "[%" << instruction->operands[i]->id << ", bb" << instruction->incoming_blocks[i]->id << "]";
+            }
+            break;
+        default: {
+            o << get_opcode_string(instruction->opcode);
+            if (instruction->opcode == IR_FUNCTION_CALL) o << " " << instruction->function->name;
+            if (instruction->opcode == IR_BUILTIN_CALL) o << " " << instruction->builtin->name;
+            for (int i = 0; i < (int) instruction->operands.size(); i++) {
+                o << (i == 0 ? " " : ", ");
+                if (instruction->opcode == IR_FUNCTION_CALL) o << instruction->argument_names[i] << "=";
+                o << "%" << instruction->operands[i]->id;
+            }
+            break;
+        }
+    }
+
+    if ((instruction->opcode == IR_COPY || instruction->opcode == IR_PHI) && !instruction->variable_name.empty()) o << "  ; " << instruction->variable_name;
+    o << std::endl;
+}
+
+std::ostream& operator<<(std::ostream& o, IrFunction& function) {
+    o << "function " << function.name << "(";
+    for (int i = 0; i < (int) function.parameters.size(); i++) o << (i == 0 ? "" : ", ") << function.parameters[i];
+    o << ")" << std::endl;
+
+    for (IrBasicBlock* block : function.get_blocks()) {
+        o << "  bb" << block->id << ":" << std::endl;
+        for (IrInstruction* instruction : block->instructions) print_instruction(o, instruction);
+        if (block->branch_condition != nullptr) o << "    branch %" << block->branch_condition->id << ", bb" << block->successors[0]->id << ", bb" << block->successors[1]->id << std::endl;
+        else if (block->successors.size() == 1) o << "    jump bb" << block->successors[0]->id << std::endl;
+    }
+    return o;
+}
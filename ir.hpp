@@ -0,0 +1,97 @@
+#ifndef IR_H
+#define IR_H
+
+#include "syntax-tree.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <iostream>
+
+// A mid-level SSA form of one function body. Every value is defined once
+// by an instruction, and variables only exist while the body is lowered
+// into this form and back out of it.
+
+enum IrOpcode {
+    IR_CONSTANT,
+    IR_PARAMETER,
+    IR_COPY,
+    IR_PHI,
+    IR_BINARY_OPERATION,
+    IR_BUILTIN_CALL,
+    IR_FUNCTION_CALL,
+    IR_PRINT,
+    IR_RETURN
+};
+
+struct IrBasicBlock;
+
+struct IrInstruction {
+    int id;
+    IrOpcode opcode;
+    std::vector<IrInstruction*> operands;
+    // For phis, the predecessor each operand arrives from.
+    std::vector<IrBasicBlock*> incoming_blocks;
+    BinaryOperation operation;
+    int constant;
+    // The source variable a parameter, copy or phi stands for.
+    std::string variable_name;
+    const FunctionData* function;
+    // For function calls, the parameter each operand is bound to.
+    std::vector<std::string> argument_names;
+    const Builtin* builtin;
+    IrBasicBlock* block;
+
+    IrInstruction(int id, IrOpcode opcode, IrBasicBlock* block) : id(id), opcode(opcode), operation(BinaryOperation::ADD), constant(0), function(nullptr), builtin(nullptr), block(block) {}
+    bool has_side_effects();
+    bool may_fail();
+};
+
+// Phis come first. A block ends in a branch on branch_condition when it
+// has two successors, and in a return when its last instruction is one.
+struct IrBasicBlock {
+    int id;
+    std::vector<IrInstruction*> instructions;
+    std::vector<IrBasicBlock*> successors;
+    IrInstruction* branch_condition;
+    IrBasicBlock(int id) : id(id), branch_condition(nullptr) {}
+};
+
+// Control flow is kept structured so it can be lowered back to if and
+// while nodes. An if branches on the condition of the block before it and
+// its join is the block after it. A while's header holds the loop phis and
+// the condition, and the block after it is the loop exit.
+struct IrRegion;
+
+struct IrRegionItem {
+    enum Kind { BLOCK, IF, WHILE };
+    Kind kind;
+    IrBasicBlock* block;
+    std::unique_ptr<IrRegion> first;
+    std::unique_ptr<IrRegion> second;
+};
+
+struct IrRegion {
+    std::vector<IrRegionItem> items;
+};
+
+class IrFunction {
+private:
+    std::vector<std::unique_ptr<IrInstruction>> instructions;
+    std::vector<std::unique_ptr<IrBasicBlock>> blocks;
+
+public:
+    std::string name;
+    std::vector<std::string> parameters;
+    IrRegion body;
+
+    IrFunction(const std::string& name, const std::vector<std::string>& parameters) : name(name), parameters(parameters) {}
+    IrInstruction* new_instruction(IrOpcode opcode, IrBasicBlock* block);
+    IrBasicBlock* new_block();
+    std::vector<IrBasicBlock*> get_blocks();
+    void replace_uses(std::map<IrInstruction*, IrInstruction*>& replacements);
+};
+
+std::ostream& operator<<(std::ostream& o, IrFunction& function);
+
+#endif
@@ -0,0 +1,34 @@
+#include "program.hpp"
+#include <iostream>
+
+// Compiles and destroys programs in a loop, calling into each one. Built
+// with AddressSanitizer by `make leak-check`, which fails if destroying a
+// Program or an ExecutionContext leaves anything allocated.
+int main() {
+    const char* sample_paths[] = {
+        "samples/collatz.txt",
+        "samples/factorial.txt",
+        "samples/primes.txt",
+        "samples/pythagorean-triples.txt",
+        "samples/recursive-gcd.txt",
+        "samples/division-by-zero.txt"
+    };
+
+    for (int i = 0; i < 3; i++) {
+        for (const char* sample_path : sample_paths) {
+            std::unique_ptr<const Program> program = Program::compile_file(sample_path);
+            if (program == nullptr) return 1;
+        }
+
+        std::unique_ptr<const Program> program = Program::compile_file("samples/primes.txt");
+        ExecutionContext context;
+        int arguments[] = { 12 };
+        std::optional<int> divisors = context.call(program->find_function("count_divisors"), arguments);
+        if (divisors != 6) return 1;
+
+        // Failed compiles must release what they allocated as well.
+        if (Program::compile_source("print(gcd(12))\n") != nullptr) return 1;
+    }
+    std::cout << "No leaks found" << std::endl;
+    return 0;
+}
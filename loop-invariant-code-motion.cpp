@@ -0,0 +1,119 @@
+#include "loop-invariant-code-motion.hpp"
+#include "syntax-tree-utilities.hpp"
+
+// Whether control might not continue past this statement in the same
+// iteration, or the statement has output that must come before a later
+// failure.
+static bool may_stop_iteration(SyntaxTreeNode* statement) {
+    return contains_node_type(statement, RETURN) || contains_node_type(statement, WHILE) || contains_node_type(statement, FUNCTION_CALL) || contains_node_type(statement, PRINT) || contains_impure_builtin_call(statement);
+}
+
+// Whether evaluating this value can crash or fail to terminate. Values
+// lowered from the IR can nest operations, so the whole value is checked.
+static bool may_fail(SyntaxTreeNode* value) {
+    if (value->node_type == SyntaxTreeNodeType::FUNCTION_CALL) return true;
+    if (value->node_type == SyntaxTreeNodeType::BINARY_OPERATION) {
+        BinaryOperation operation = static_cast<BinaryOperationNode*>(value)->operation;
+        if (operation == BinaryOperation::DIVIDE || operation == BinaryOperation::MOD) return true;
+    }
+    std::vector<SyntaxTreeNode*> children;
+    get_children(value, children);
+    for (SyntaxTreeNode* child : children) {
+        if (may_fail(child)) return true;
+    }
+    return false;
+}
+
+void LoopInvariantCodeMotion::find_impure_functions(std::vector<FunctionData*>& functions) {
+    std::map<FunctionData*, std::set<const FunctionData*>> callees;
+    for (FunctionData* function : functions) {
+        if (function->body == nullptr || contains_node_type(function->body, PRINT) || contains_impure_builtin_call(function->body)) impure_functions.insert(function);
+        else collect_calls(function->body, callees[function]);
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (std::pair<FunctionData* const, std::set<const FunctionData*>>& entry : callees) {
+            if (impure_functions.count(entry.first)) continue;
+            for (const FunctionData* callee : entry.second) {
+                if (impure_functions.count(callee)) {
+                    impure_functions.insert(entry.first);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+bool LoopInvariantCodeMotion::is_invariant_assignment(SyntaxTreeNode* statement, AssignmentCounts& assignment_counts, std::set<std::string>& condition_reads, std::set<std::string>& reads_before) {
+    if (statement->node_type != SyntaxTreeNodeType::ASSIGNMENT) return false;
+    AssignmentNode* assignment_node = static_cast<AssignmentNode*>(statement);
+    std::string& variable_name = assignment_node->variable_name;
+
+    if (assignment_counts[variable_name] != 1) return false;
+    if (condition_reads.count(variable_name) || reads_before.count(variable_name)) return false;
+
+    SyntaxTreeNode* value = assignment_node->value;
+    if (value->node_type == SyntaxTreeNodeType::FUNCTION_CALL && impure_functions.count(static_cast<FunctionNode*>(value)->function)) return false;
+    if (contains_impure_builtin_call(value)) return false;
+
+    std::set<std::string> value_reads;
+    collect_reads(value, value_reads);
+    for (const std::string& read : value_reads) {
+        if (read == variable_name) return false;
+        AssignmentCounts::iterator count = assignment_counts.find(read);
+        if (count != assignment_counts.end() && count->second > 0) return false;
+    }
+    return true;
+}
+
+void LoopInvariantCodeMotion::hoist_invariants(WhileNode* node) {
+    std::vector<SyntaxTreeNode*> statements;
+    if (node->body->node_type == SyntaxTreeNodeType::STATEMENT_SEQUENCE) statements = static_cast<StatementSequenceNode*>(node->body)->statements;
+    else statements.push_back(node->body);
+
+    AssignmentCounts assignment_counts;
+    collect_assignments(node->body, assignment_counts);
+    std::set<std::string> condition_reads;
+    collect_reads(node->condition, condition_reads);
+
+    std::set<std::string> reads_before;
+    bool iteration_may_stop = false;
+    std::vector<SyntaxTreeNode*> hoisted;
+    std::vector<SyntaxTreeNode*> remaining;
+    for (SyntaxTreeNode* statement : statements) {
+        if (is_invariant_assignment(statement, assignment_counts, condition_reads, reads_before)) {
+            AssignmentNode* assignment_node = static_cast<AssignmentNode*>(statement);
+            if (!iteration_may_stop || !may_fail(assignment_node->value)) {
+                hoisted.push_back(statement);
+                assignment_counts[assignment_node->variable_name] = 0;
+                continue;
+            }
+        }
+        remaining.push_back(statement);
+        collect_reads(statement, reads_before);
+        if (may_stop_iteration(statement)) iteration_may_stop = true;
+    }
+
+    if (hoisted.empty()) return;
+
+    if (hoisted.size() == 1) node->preheader = hoisted[0];
+    else node->preheader = new StatementSequenceNode(hoisted);
+
+    if (remaining.empty()) node->body = new EmptyNode();
+    else if (remaining.size() == 1) node->body = remaining[0];
+    else node->body = new StatementSequenceNode(remaining);
+}
+
+void LoopInvariantCodeMotion::optimize(SyntaxTreeNode* node) {
+    std::vector<SyntaxTreeNode*> children;
+    get_children(node, children);
+    for (SyntaxTreeNode* child : children) optimize(child);
+    if (node->node_type == SyntaxTreeNodeType::WHILE) hoist_invariants(static_cast<WhileNode*>(node));
+}
+
+void LoopInvariantCodeMotion::run(SyntaxTreeNode* root) {
+    optimize(root);
+}
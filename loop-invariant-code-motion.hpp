@@ -0,0 +1,33 @@
+#ifndef LOOP_INVARIANT_CODE_MOTION_H
+#define LOOP_INVARIANT_CODE_MOTION_H
+
+#include "syntax-tree.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+
+// Moves assignments whose value cannot change between iterations of a
+// while loop into the loop's preheader. A candidate must be the only
+// assignment to its variable in the loop, must not be read earlier in the
+// body or in the condition, and may only read variables the loop never
+// assigns. Function calls qualify when no print or impure builtin is
+// reachable from them.
+class LoopInvariantCodeMotion {
+private:
+    using AssignmentCounts = std::map<std::string, int>;
+    std::set<const FunctionData*> impure_functions;
+
+    void find_impure_functions(std::vector<FunctionData*>& functions);
+    bool is_invariant_assignment(SyntaxTreeNode* statement, AssignmentCounts& assignment_counts, std::set<std::string>& condition_reads, std::set<std::string>& reads_before);
+    void hoist_invariants(WhileNode* node);
+    void optimize(SyntaxTreeNode* node);
+
+public:
+    LoopInvariantCodeMotion(std::vector<FunctionData*> functions) {
+        find_impure_functions(functions);
+    }
+    void run(SyntaxTreeNode* root);
+};
+
+#endif
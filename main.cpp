@@ -1,14 +1,52 @@
 #include <iostream>
 #include <string>
+#include <charconv>
+#include <limits>
 #include "interpreter.hpp"
 #include "debug.hpp"
 
+// Reads a whole number of megabytes, rejecting anything that is not one or
+// that would overflow when converted to bytes.
+static bool parse_memory_limit(const std::string& text, std::size_t& bytes) {
+    const std::size_t bytes_per_megabyte = 1024 * 1024;
+    std::size_t megabytes = 0;
+    const char* end = text.data() + text.size();
+    std::from_chars_result result = std::from_chars(text.data(), end, megabytes);
+    if (text.empty() || result.ec != std::errc() || result.ptr != end) return false;
+    if (megabytes > std::numeric_limits<std::size_t>::max() / bytes_per_megabyte) return false;
+    bytes = megabytes * bytes_per_megabyte;
+    return true;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc <= 1) std::cout << "Please provide an inpute file." << std::endl;
+    std::string input_file;
+    std::size_t call_stack_memory_limit = CallStack::DEFAULT_MEMORY_LIMIT;
+    std::string stats_format;
+    bool dump_ir = false;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--max-stack-memory") {
+            if (i + 1 >= argc || !parse_memory_limit(argv[++i], call_stack_memory_limit)) {
+                std::cerr << "Usage: --max-stack-memory expects a whole number of megabytes" << std::endl;
+                return 2;
+            }
+        }
+        else if (argument == "--stats") stats_format = "table";
+        else if (argument == "--stats=json") stats_format = "json";
+        else if (argument == "--dump-ir") dump_ir = true;
+        else input_file = argument;
+    }
+
+    int exit_status = 0;
+    if (input_file.empty()) std::cout << "Please provide an inpute file." << std::endl;
     else {
-        std::string input_file = argv[1];
         Interpreter interpreter(input_file);
-        interpreter.run();
+        interpreter.set_call_stack_memory_limit(call_stack_memory_limit);
+        interpreter.set_dump_ir(dump_ir);
+        if (!interpreter.run()) exit_status = 1;
+        if (!STATS_ON && !stats_format.empty()) std::cerr << "Error: stats were compiled out of this build" << std::endl;
+        else if (stats_format == "table") stats.print_table(std::cerr);
+        else if (stats_format == "json") stats.print_json(std::cerr);
     }
-    return 0;
+    return exit_status;
 }
@@ -0,0 +1,29 @@
+#include "node-arena.hpp"
+#include <new>
+
+thread_local NodeArena* NodeArena::current = nullptr;
+
+NodeArena::~NodeArena() {
+    for (std::size_t i = objects.size(); i > 0; i--) objects[i - 1].destroy(objects[i - 1].pointer);
+    for (char* block : blocks) delete[] block;
+}
+
+void* NodeArena::allocate(std::size_t size, void (*destroy)(void* pointer)) {
+    std::size_t alignment = alignof(std::max_align_t);
+    size = (size + alignment - 1) / alignment * alignment;
+    void* pointer = nullptr;
+    if (size > BLOCK_SIZE) {
+        char* block = new char[size];
+        blocks.insert(blocks.begin(), block);
+        pointer = block;
+    } else {
+        if (block_used + size > BLOCK_SIZE) {
+            blocks.push_back(new char[BLOCK_SIZE]);
+            block_used = 0;
+        }
+        pointer = blocks.back() + block_used;
+        block_used += size;
+    }
+    objects.push_back(Object { pointer, destroy });
+    return pointer;
+}
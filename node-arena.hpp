@@ -0,0 +1,33 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <vector>
+#include <cstddef>
+
+// Bump allocator for syntax tree nodes. Each parsing thread allocates from
+// its own arena, so no locking is needed. When the arena is destroyed, it
+// destroys its objects in reverse order of allocation and then releases
+// their memory together.
+class NodeArena {
+private:
+    struct Object {
+        void* pointer;
+        void (*destroy)(void* pointer);
+    };
+
+    static const std::size_t BLOCK_SIZE = 64 * 1024;
+    std::vector<char*> blocks;
+    std::size_t block_used;
+    std::vector<Object> objects;
+
+public:
+    static thread_local NodeArena* current;
+
+    NodeArena() : block_used(BLOCK_SIZE) {}
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+    ~NodeArena();
+    void* allocate(std::size_t size, void (*destroy)(void* pointer));
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "node-specializer.hpp"
+
+static SpecializedOperandKind get_operand_kind(SyntaxTreeNode* node) {
+    if (node->node_type != OPERAND) return EXPRESSION_OPERAND;
+    return static_cast<OperandNode*>(node)->operand_type == LITERAL ? LITERAL_OPERAND : VARIABLE_OPERAND;
+}
+
+template <BinaryOperation operation, SpecializedOperandKind left_kind>
+static SyntaxTreeNode* make_specialized_binary_operation(SyntaxTreeNode* left, SyntaxTreeNode* right) {
+    switch (get_operand_kind(right)) {
+        case LITERAL_OPERAND: return new SpecializedBinaryOperationNode<operation, left_kind, LITERAL_OPERAND>(left, right);
+        case VARIABLE_OPERAND: return new SpecializedBinaryOperationNode<operation, left_kind, VARIABLE_OPERAND>(left, right);
+        default: return new SpecializedBinaryOperationNode<operation, left_kind, EXPRESSION_OPERAND>(left, right);
+    }
+}
+
+template <BinaryOperation operation>
+static SyntaxTreeNode* make_specialized_binary_operation(SyntaxTreeNode* left, SyntaxTreeNode* right) {
+    switch (get_operand_kind(left)) {
+        case LITERAL_OPERAND: return make_specialized_binary_operation<operation, LITERAL_OPERAND>(left, right);
+        case VARIABLE_OPERAND: return make_specialized_binary_operation<operation, VARIABLE_OPERAND>(left, right);
+        default: return make_specialized_binary_operation<operation, EXPRESSION_OPERAND>(left, right);
+    }
+}
+
+SyntaxTreeNode* NodeSpecializer::specialize_operand(SyntaxTreeNode* node) {
+    OperandNode* operand_node = static_cast<OperandNode*>(node);
+    if (operand_node->operand_type == LITERAL) return new SpecializedOperandNode<LITERAL>(operand_node);
+    return new SpecializedOperandNode<IDENTIFIER>(operand_node);
+}
+
+SyntaxTreeNode* NodeSpecializer::specialize_binary_operation(BinaryOperationNode* node) {
+    SyntaxTreeNode* left = specialize(node->left_operand);
+    SyntaxTreeNode* right = specialize(node->right_operand);
+
+    switch (node->operation) {
+        case BinaryOperation::ADD: return make_specialized_binary_operation<BinaryOperation::ADD>(left, right);
+        case BinaryOperation::SUBTRACT: return make_specialized_binary_operation<BinaryOperation::SUBTRACT>(left, right);
+        case BinaryOperation::MULTIPLY: return make_specialized_binary_operation<BinaryOperation::MULTIPLY>(left, right);
+        case BinaryOperation::DIVIDE: return make_specialized_binary_operation<BinaryOperation::DIVIDE>(left, right);
+        case BinaryOperation::MOD: return make_specialized_binary_operation<BinaryOperation::MOD>(left, right);
+        case BinaryOperation::LESS: return make_specialized_binary_operation<BinaryOperation::LESS>(left, right);
+        case BinaryOperation::LESS_EQUAL: return make_specialized_binary_operation<BinaryOperation::LESS_EQUAL>(left, right);
+        case BinaryOperation::GREATER: return make_specialized_binary_operation<BinaryOperation::GREATER>(left, right);
+        case BinaryOperation::GREATER_EQUAL: return make_specialized_binary_operation<BinaryOperation::GREATER_EQUAL>(left, right);
+        case BinaryOperation::EQUAL: return make_specialized_binary_operation<BinaryOperation::EQUAL>(left, right);
+        case BinaryOperation::NOT_EQUAL: return make_specialized_binary_operation<BinaryOperation::NOT_EQUAL>(left, right);
+        case BinaryOperation::AND: return make_specialized_binary_operation<BinaryOperation::AND>(left, right);
+        case BinaryOperation::OR: return make_specialized_binary_operation<BinaryOperation::OR>(left, right);
+    }
+    return node;
+}
+
+SyntaxTreeNode* NodeSpecializer::specialize(SyntaxTreeNode* node) {
+    switch (node->node_type) {
+        case SyntaxTreeNodeType::STATEMENT_SEQUENCE:
+            for (SyntaxTreeNode*& statement : static_cast<StatementSequenceNode*>(node)->statements) statement = specialize(statement);
+            return node;
+        case SyntaxTreeNodeType::OPERAND:
+            return specialize_operand(node);
+        case SyntaxTreeNodeType::RETURN: {
+            ReturnNode* return_node = static_cast<ReturnNode*>(node);
+            return_node->value = specialize(return_node->value);
+            return node;
+        }
+        case SyntaxTreeNodeType::ASSIGNMENT: {
+            AssignmentNode* assignment_node = static_cast<AssignmentNode*>(node);
+            assignment_node->value = specialize(assignment_node->value);
+            return node;
+        }
+        case SyntaxTreeNodeType::PRINT: {
+            PrintNode* print_node = static_cast<PrintNode*>(node);
+            print_node->value = specialize(print_node->value);
+            return node;
+        }
+        case SyntaxTreeNodeType::BINARY_OPERATION:
+            return specialize_binary_operation(static_cast<BinaryOperationNode*>(node));
+        case SyntaxTreeNodeType::IF_ELSE: {
+            IfElseNode* if_else_node = static_cast<IfElseNode*>(node);
+            if_else_node->condition = specialize(if_else_node->condition);
+            if_else_node->if_block = specialize(if_else_node->if_block);
+            if_else_node->else_block = specialize(if_else_node->else_block);
+            return node;
+        }
+        case SyntaxTreeNodeType::FUNCTION_CALL:
+            for (std::pair<const std::string, SyntaxTreeNode*>& argument : static_cast<FunctionNode*>(node)->arguments) argument.second = specialize(argument.second);
+            return node;
+        case SyntaxTreeNodeType::BUILTIN_CALL:
+            for (SyntaxTreeNode*& argument : static_cast<BuiltinCallNode*>(node)->arguments) argument = specialize(argument);
+            return node;
+        case SyntaxTreeNodeType::WHILE: {
+            WhileNode* while_node = static_cast<WhileNode*>(node);
+            while_node->condition = specialize(while_node->condition);
+            if (while_node->preheader != nullptr) while_node->preheader = specialize(while_node->preheader);
+            while_node->body = specialize(while_node->body);
+            return node;
+        }
+        default:
+            return node;
+    }
+}
+
+SyntaxTreeNode* NodeSpecializer::run(SyntaxTreeNode* root) {
+    return specialize(root);
+}
@@ -0,0 +1,79 @@
+#ifndef NODE_SPECIALIZER_H
+#define NODE_SPECIALIZER_H
+
+#include "syntax-tree.hpp"
+#include <string>
+
+// Operands whose kind is fixed when the node is built, so evaluating one
+// does not branch on operand_type.
+template <OperandType kind>
+struct SpecializedOperandNode : OperandNode {
+    SpecializedOperandNode(OperandNode* node) : OperandNode(*node) {}
+    EvaluationResult evaluate(Variables& variables) {
+        EvaluationResult result;
+        if constexpr (kind == LITERAL) result.expression_value = literal_value;
+        else result.expression_value = variables.get_variable_value(identifier_value);
+        return result;
+    }
+};
+
+// How a binary operation reads an operand: a literal or a variable stored
+// in the node itself, or a nested expression evaluated through its node.
+enum SpecializedOperandKind {
+    LITERAL_OPERAND, VARIABLE_OPERAND, EXPRESSION_OPERAND
+};
+
+template <SpecializedOperandKind kind>
+inline int load_operand(SyntaxTreeNode* node, int literal, const std::string* identifier, Variables& variables) {
+    if constexpr (kind == LITERAL_OPERAND) return literal;
+    else if constexpr (kind == VARIABLE_OPERAND) return variables.get_variable_value(*identifier);
+    else return node->evaluate(variables).expression_value;
+}
+
+// One instantiation per operator and pair of operand kinds. Literal and
+// variable operands are read inline instead of through the operand nodes,
+// which are kept only so passes and printing still see an ordinary binary
+// operation.
+template <BinaryOperation specialized_operation, SpecializedOperandKind left_kind, SpecializedOperandKind right_kind>
+struct SpecializedBinaryOperationNode : BinaryOperationNode {
+    int left_literal;
+    int right_literal;
+    const std::string* left_identifier;
+    const std::string* right_identifier;
+
+    SpecializedBinaryOperationNode(SyntaxTreeNode* left, SyntaxTreeNode* right) : BinaryOperationNode(specialized_operation, left, right), left_literal(0), right_literal(0), left_identifier(nullptr), right_identifier(nullptr) {
+        if constexpr (left_kind != EXPRESSION_OPERAND) {
+            left_literal = static_cast<OperandNode*>(left)->literal_value;
+            left_identifier = &static_cast<OperandNode*>(left)->identifier_value;
+        }
+        if constexpr (right_kind != EXPRESSION_OPERAND) {
+            right_literal = static_cast<OperandNode*>(right)->literal_value;
+            right_identifier = &static_cast<OperandNode*>(right)->identifier_value;
+        }
+    }
+
+    EvaluationResult evaluate(Variables& variables) {
+        RECORD_STAT(stats.binary_operations[specialized_operation]++);
+        int left_value = load_operand<left_kind>(left_operand, left_literal, left_identifier, variables);
+        int right_value = load_operand<right_kind>(right_operand, right_literal, right_identifier, variables);
+
+        EvaluationResult result;
+        result.expression_value = apply_binary_operation<specialized_operation>(left_value, right_value);
+        return result;
+    }
+};
+
+// Replaces generic operand and binary operation nodes with the
+// specialized ones above. Runs after the other passes, since those rewrite
+// operands in place and a specialized node caches its operands.
+class NodeSpecializer {
+private:
+    SyntaxTreeNode* specialize_operand(SyntaxTreeNode* node);
+    SyntaxTreeNode* specialize_binary_operation(BinaryOperationNode* node);
+    SyntaxTreeNode* specialize(SyntaxTreeNode* node);
+
+public:
+    SyntaxTreeNode* run(SyntaxTreeNode* root);
+};
+
+#endif
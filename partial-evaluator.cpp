@@ -0,0 +1,220 @@
+#include "partial-evaluator.hpp"
+#include "syntax-tree-utilities.hpp"
+#include <set>
+#include <climits>
+
+static bool is_literal(SyntaxTreeNode* node) {
+    return node->node_type == SyntaxTreeNodeType::OPERAND && static_cast<OperandNode*>(node)->operand_type == LITERAL;
+}
+
+static int get_literal_value(SyntaxTreeNode* node) {
+    return static_cast<OperandNode*>(node)->literal_value;
+}
+
+// Operations that would fault or overflow are left to run time.
+static bool can_fold(BinaryOperation operation, int left_value, int right_value) {
+    long long left = left_value;
+    long long right = right_value;
+    switch (operation) {
+        case BinaryOperation::ADD:
+            return INT_MIN <= left + right && left + right <= INT_MAX;
+        case BinaryOperation::SUBTRACT:
+            return INT_MIN <= left - right && left - right <= INT_MAX;
+        case BinaryOperation::MULTIPLY:
+            return INT_MIN <= left * right && left * right <= INT_MAX;
+        case BinaryOperation::DIVIDE:
+        case BinaryOperation::MOD:
+            return right != 0 && !(left == INT_MIN && right == -1);
+        default:
+            return true;
+    }
+}
+
+FunctionData* PartialEvaluator::get_specialization(const FunctionData* function, std::vector<std::pair<std::string, int>>& constant_arguments) {
+    SpecializationKey key = { function, constant_arguments };
+    std::map<SpecializationKey, FunctionData*>::iterator cached = specialization_cache.find(key);
+    if (cached != specialization_cache.end()) return cached->second;
+    if (function->body == nullptr) return nullptr;
+    if (specializations.size() >= MAX_SPECIALIZATIONS || specialization_depth >= MAX_SPECIALIZATION_DEPTH) return nullptr;
+
+    Constants constants(constant_arguments.begin(), constant_arguments.end());
+
+    specializations.push_back(FunctionData());
+    FunctionData* specialization = &specializations.back();
+    specialization->name = function->name + "(";
+    for (std::size_t i = 0; i < constant_arguments.size(); i++) {
+        if (i > 0) specialization->name += ", ";
+        specialization->name += constant_arguments[i].first + "=" + std::to_string(constant_arguments[i].second);
+    }
+    specialization->name += ")";
+    for (const std::string& parameter : function->parameters) {
+        if (constants.find(parameter) == constants.end()) specialization->parameters.push_back(parameter);
+    }
+    specialization->id = stats.register_function(specialization->name);
+
+    // Cached before the body is simplified so recursive calls with the
+    // same arguments resolve to this specialization.
+    specialization_cache[key] = specialization;
+
+    specialization_depth++;
+    SyntaxTreeNode* body = simplify_statement(clone_syntax_tree(function->body), constants);
+    specialization_depth--;
+
+    // Parameters that are still read somewhere must exist at run time.
+    std::set<std::string> reads;
+    collect_reads(body, reads);
+    std::vector<SyntaxTreeNode*> statements;
+    for (std::pair<std::string, int>& constant_argument : constant_arguments) {
+        if (!reads.count(constant_argument.first)) continue;
+        SyntaxTreeNode* value = new OperandNode(LITERAL, constant_argument.second);
+        statements.push_back(new AssignmentNode(constant_argument.first, value));
+    }
+    if (!statements.empty()) {
+        statements.push_back(body);
+        body = new StatementSequenceNode(statements);
+    }
+
+    specialization->body = body;
+    return specialization;
+}
+
+void PartialEvaluator::specialize_call(FunctionNode* node) {
+    std::vector<std::pair<std::string, int>> constant_arguments;
+    for (std::pair<const std::string, SyntaxTreeNode*>& argument : node->arguments) {
+        if (is_literal(argument.second)) constant_arguments.push_back({ argument.first, get_literal_value(argument.second) });
+    }
+    if (constant_arguments.empty()) return;
+
+    FunctionData* specialization = get_specialization(node->function, constant_arguments);
+    if (specialization == nullptr) return;
+
+    node->function = specialization;
+    for (std::pair<std::string, int>& constant_argument : constant_arguments) node->arguments.erase(constant_argument.first);
+}
+
+SyntaxTreeNode* PartialEvaluator::simplify_expression(SyntaxTreeNode* node, Constants& constants) {
+    switch (node->node_type) {
+        case SyntaxTreeNodeType::OPERAND: {
+            OperandNode* operand_node = static_cast<OperandNode*>(node);
+            if (operand_node->operand_type == LITERAL) return node;
+            Constants::iterator constant = constants.find(operand_node->identifier_value);
+            if (constant == constants.end()) return node;
+            return new OperandNode(LITERAL, constant->second);
+        }
+        case SyntaxTreeNodeType::BINARY_OPERATION: {
+            BinaryOperationNode* binary_operation_node = static_cast<BinaryOperationNode*>(node);
+            binary_operation_node->left_operand = simplify_expression(binary_operation_node->left_operand, constants);
+            binary_operation_node->right_operand = simplify_expression(binary_operation_node->right_operand, constants);
+            if (!is_literal(binary_operation_node->left_operand) || !is_literal(binary_operation_node->right_operand)) return node;
+
+            BinaryOperation operation = binary_operation_node->operation;
+            int left_value = get_literal_value(binary_operation_node->left_operand);
+            int right_value = get_literal_value(binary_operation_node->right_operand);
+            if (!can_fold(operation, left_value, right_value)) return node;
+            return new OperandNode(LITERAL, apply_binary_operation(operation, left_value, right_value));
+        }
+        case SyntaxTreeNodeType::FUNCTION_CALL: {
+            FunctionNode* function_node = static_cast<FunctionNode*>(node);
+            for (std::pair<const std::string, SyntaxTreeNode*>& argument : function_node->arguments) {
+                argument.second = simplify_expression(argument.second, constants);
+            }
+            specialize_call(function_node);
+            return node;
+        }
+        case SyntaxTreeNodeType::BUILTIN_CALL: {
+            BuiltinCallNode* builtin_call_node = static_cast<BuiltinCallNode*>(node);
+            // The parser checks arity, but folding must not write past the buffer if it did not.
+            if (builtin_call_node->arguments.size() > (std::size_t) BuiltinRegistry::MAX_ARITY) return node;
+            int argument_values[BuiltinRegistry::MAX_ARITY];
+            bool all_literal = true;
+            for (std::size_t i = 0; i < builtin_call_node->arguments.size(); i++) {
+                SyntaxTreeNode*& argument = builtin_call_node->arguments[i];
+                argument = simplify_expression(argument, constants);
+                if (is_literal(argument)) argument_values[i] = get_literal_value(argument);
+                else all_literal = false;
+            }
+            if (!all_literal || !builtin_call_node->builtin->is_pure) return node;
+            return new OperandNode(LITERAL, builtin_call_node->builtin->function(argument_values, builtin_call_node->builtin->user_data));
+        }
+        default:
+            return node;
+    }
+}
+
+SyntaxTreeNode* PartialEvaluator::simplify_if_else(IfElseNode* node, Constants& constants) {
+    node->condition = simplify_expression(node->condition, constants);
+    if (is_literal(node->condition)) {
+        SyntaxTreeNode* taken_block = get_literal_value(node->condition) ? node->if_block : node->else_block;
+        return simplify_statement(taken_block, constants);
+    }
+
+    Constants else_constants = constants;
+    node->if_block = simplify_statement(node->if_block, constants);
+    node->else_block = simplify_statement(node->else_block, else_constants);
+
+    for (Constants::iterator constant = constants.begin(); constant != constants.end();) {
+        Constants::iterator else_constant = else_constants.find(constant->first);
+        if (else_constant == else_constants.end() || else_constant->second != constant->second) constant = constants.erase(constant);
+        else constant++;
+    }
+    return node;
+}
+
+SyntaxTreeNode* PartialEvaluator::simplify_while(WhileNode* node, Constants& constants) {
+    // Anything assigned in the loop may differ between iterations.
+    std::map<std::string, int> assignment_counts;
+    collect_assignments(node, assignment_counts);
+    for (std::pair<const std::string, int>& assignment_count : assignment_counts) constants.erase(assignment_count.first);
+
+    node->condition = simplify_expression(node->condition, constants);
+    if (is_literal(node->condition) && get_literal_value(node->condition) != 1) return new EmptyNode();
+
+    Constants body_constants = constants;
+    if (node->preheader != nullptr) node->preheader = simplify_statement(node->preheader, body_constants);
+    node->body = simplify_statement(node->body, body_constants);
+    return node;
+}
+
+SyntaxTreeNode* PartialEvaluator::simplify_statement(SyntaxTreeNode* node, Constants& constants) {
+    switch (node->node_type) {
+        case SyntaxTreeNodeType::STATEMENT_SEQUENCE:
+            for (SyntaxTreeNode*& statement : static_cast<StatementSequenceNode*>(node)->statements) {
+                statement = simplify_statement(statement, constants);
+            }
+            return node;
+        case SyntaxTreeNodeType::ASSIGNMENT: {
+            AssignmentNode* assignment_node = static_cast<AssignmentNode*>(node);
+            assignment_node->value = simplify_expression(assignment_node->value, constants);
+            if (is_literal(assignment_node->value)) constants[assignment_node->variable_name] = get_literal_value(assignment_node->value);
+            else constants.erase(assignment_node->variable_name);
+            return node;
+        }
+        case SyntaxTreeNodeType::PRINT: {
+            PrintNode* print_node = static_cast<PrintNode*>(node);
+            print_node->value = simplify_expression(print_node->value, constants);
+            return node;
+        }
+        case SyntaxTreeNodeType::RETURN: {
+            ReturnNode* return_node = static_cast<ReturnNode*>(node);
+            return_node->value = simplify_expression(return_node->value, constants);
+            return node;
+        }
+        case SyntaxTreeNodeType::FUNCTION_CALL:
+            return simplify_expression(node, constants);
+        case SyntaxTreeNodeType::IF_ELSE:
+            return simplify_if_else(static_cast<IfElseNode*>(node), constants);
+        case SyntaxTreeNodeType::WHILE:
+            return simplify_while(static_cast<WhileNode*>(node), constants);
+        default:
+            return node;
+    }
+}
+
+SyntaxTreeNode* PartialEvaluator::run(SyntaxTreeNode* root) {
+    Constants constants;
+    return simplify_statement(root, constants);
+}
+
+std::deque<FunctionData>& PartialEvaluator::get_specializations() {
+    return specializations;
+}
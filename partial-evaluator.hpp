@@ -0,0 +1,40 @@
+#ifndef PARTIAL_EVALUATOR_H
+#define PARTIAL_EVALUATOR_H
+
+#include "syntax-tree.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <deque>
+#include <utility>
+
+// Specializes functions for call sites that pass literal arguments. The
+// body is copied with the known parameters propagated as constants, which
+// folds binary operations and pure builtin calls, picks if/else branches
+// and drops loops whose condition is known to be false. Specializations are cached per function
+// and constant arguments, up to MAX_SPECIALIZATIONS.
+class PartialEvaluator {
+private:
+    using Constants = std::map<std::string, int>;
+    using SpecializationKey = std::pair<const FunctionData*, std::vector<std::pair<std::string, int>>>;
+
+    static const int MAX_SPECIALIZATIONS = 64;
+    static const int MAX_SPECIALIZATION_DEPTH = 4;
+    std::map<SpecializationKey, FunctionData*> specialization_cache;
+    std::deque<FunctionData> specializations;
+    int specialization_depth;
+
+    FunctionData* get_specialization(const FunctionData* function, std::vector<std::pair<std::string, int>>& constant_arguments);
+    void specialize_call(FunctionNode* node);
+    SyntaxTreeNode* simplify_expression(SyntaxTreeNode* node, Constants& constants);
+    SyntaxTreeNode* simplify_statement(SyntaxTreeNode* node, Constants& constants);
+    SyntaxTreeNode* simplify_while(WhileNode* node, Constants& constants);
+    SyntaxTreeNode* simplify_if_else(IfElseNode* node, Constants& constants);
+
+public:
+    PartialEvaluator() : specialization_depth(0) {}
+    SyntaxTreeNode* run(SyntaxTreeNode* root);
+    std::deque<FunctionData>& get_specializations();
+};
+
+#endif
@@ -0,0 +1,34 @@
+#include "program.hpp"
+#include <fstream>
+#include <sstream>
+
+std::unique_ptr<const Program> Program::compile_source(const std::string& source, const BuiltinRegistry& builtins) {
+    std::unique_ptr<Program> program(new Program());
+    program->interpreter->set_builtin_registry(builtins);
+    if (!program->interpreter->compile(source)) return nullptr;
+    return program;
+}
+
+std::unique_ptr<const Program> Program::compile_file(const std::string& input_file_path, const BuiltinRegistry& builtins) {
+    std::ifstream input_file_stream(input_file_path);
+    if (!input_file_stream) {
+        std::cerr << "Error: could not open " << input_file_path << std::endl;
+        return nullptr;
+    }
+    std::stringstream input_string_stream;
+    input_string_stream << input_file_stream.rdbuf();
+    return compile_source(input_string_stream.str(), builtins);
+}
+
+const FunctionData* Program::find_function(const std::string& name) const {
+    return interpreter->find_function(name);
+}
+
+std::optional<int> ExecutionContext::call(const FunctionData* function, std::span<const int> arguments) {
+    if (function == nullptr) {
+        std::cerr << "Error: called a function that does not exist" << std::endl;
+        return std::nullopt;
+    }
+    host_call.function = function;
+    return call_stack.call(&host_call, arguments);
+}
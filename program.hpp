@@ -0,0 +1,51 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+// The library is built with STATS_ON=0, and host code must see the same
+// value in the headers it shares with the library, or inline functions
+// that record stats would differ between the two.
+#ifndef STATS_ON
+#define STATS_ON 0
+#elif STATS_ON
+#error "libinterp is built without stats: include program.hpp before the other headers and leave STATS_ON undefined or 0"
+#endif
+
+#include "interpreter.hpp"
+#include <string>
+#include <memory>
+#include <span>
+#include <optional>
+
+// Embedding interface. A Program is compiled once and is not modified
+// afterwards, so any number of threads may call into it at the same time,
+// each through its own ExecutionContext. Top level statements of the
+// source are parsed but not run. Compiling returns null if the source has
+// errors or the file cannot be read.
+class Program {
+private:
+    std::unique_ptr<Interpreter> interpreter;
+    Program() : interpreter(std::make_unique<Interpreter>()) {}
+
+public:
+    static std::unique_ptr<const Program> compile_source(const std::string& source, const BuiltinRegistry& builtins = BuiltinRegistry());
+    static std::unique_ptr<const Program> compile_file(const std::string& input_file_path, const BuiltinRegistry& builtins = BuiltinRegistry());
+    const FunctionData* find_function(const std::string& name) const;
+};
+
+// Variables and call stack for one host thread. A context can be reused
+// for any number of calls, which stop allocating once its buffers have
+// grown to fit the deepest call seen. A call returns nothing if the
+// function is null, the argument count is wrong or the call stack runs
+// out of memory.
+class ExecutionContext {
+private:
+    Variables variables;
+    CallStack call_stack;
+    FunctionNode host_call;
+
+public:
+    ExecutionContext(std::size_t call_stack_memory_limit = CallStack::DEFAULT_MEMORY_LIMIT) : call_stack(variables, call_stack_memory_limit), host_call(nullptr, {}) {}
+    std::optional<int> call(const FunctionData* function, std::span<const int> arguments);
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "stats.hpp"
+#include "syntax-tree.hpp"
+#include <cstdlib>
+#include <new>
+
+Stats stats;
+
+#if STATS_ON
+void* operator new(std::size_t size) {
+    if (stats.tracking_allocations) {
+        stats.evaluation_allocations++;
+        stats.evaluation_bytes_allocated += size;
+    }
+    void* pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    operator delete(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    operator delete[](pointer);
+}
+#endif
+
+Stats::Stats() :
+    variable_lookups(0),
+    variable_lookup_entries_walked(0),
+    block_scopes_entered(0),
+    function_scopes_entered(0),
+    nodes_allocated(0),
+    evaluation_allocations(0),
+    evaluation_bytes_allocated(0),
+    tracking_allocations(false),
+    binary_operations(BinaryOperation::OR + 1, 0) {}
+
+int Stats::register_function(const std::string& name) {
+    // Skipped when compiled out, so compiling programs on several threads is safe.
+    if (!STATS_ON) return 0;
+    function_names.push_back(name);
+    function_calls.push_back(0);
+    return function_names.size() - 1;
+}
+
+void Stats::print_table(std::ostream& o) {
+    o << "Variable lookups:            " << variable_lookups << std::endl;
+    o << "Entries walked per lookup:   ";
+    if (variable_lookups == 0) o << 0 << std::endl;
+    else o << (double) variable_lookup_entries_walked / variable_lookups << std::endl;
+    o << "Block scopes entered:        " << block_scopes_entered << std::endl;
+    o << "Function scopes entered:     " << function_scopes_entered << std::endl;
+    o << "Nodes allocated:             " << nodes_allocated.load() << std::endl;
+    o << "Evaluation allocations:      " << evaluation_allocations << std::endl;
+    o << "Evaluation bytes allocated:  " << evaluation_bytes_allocated << std::endl;
+
+    o << "Function calls:" << std::endl;
+    for (std::size_t i = 0; i < function_names.size(); i++) {
+        o << "    " << function_names[i] << ": " << function_calls[i] << std::endl;
+    }
+
+    o << "Binary operations:" << std::endl;
+    for (std::size_t i = 0; i < binary_operations.size(); i++) {
+        if (binary_operations[i] == 0) continue;
+        o << "    " << get_binary_operation_string(static_cast<BinaryOperation>(i)) << ": " << binary_operations[i] << std::endl;
+    }
+}
+
+void Stats::print_json(std::ostream& o) {
+    o << "{";
+    o << "\"variable_lookups\": " << variable_lookups << ", ";
+    o << "\"variable_lookup_entries_walked\": " << variable_lookup_entries_walked << ", ";
+    o << "\"block_scopes_entered\": " << block_scopes_entered << ", ";
+    o << "\"function_scopes_entered\": " << function_scopes_entered << ", ";
+    o << "\"nodes_allocated\": " << nodes_allocated.load() << ", ";
+    o << "\"evaluation_allocations\": " << evaluation_allocations << ", ";
+    o << "\"evaluation_bytes_allocated\": " << evaluation_bytes_allocated << ", ";
+
+    o << "\"function_calls\": {";
+    for (std::size_t i = 0; i < function_names.size(); i++) {
+        if (i > 0) o << ", ";
+        o << "\"" << function_names[i] << "\": " << function_calls[i];
+    }
+    o << "}, ";
+
+    o << "\"binary_operations\": {";
+    for (std::size_t i = 0; i < binary_operations.size(); i++) {
+        if (i > 0) o << ", ";
+        o << "\"" << get_binary_operation_string(static_cast<BinaryOperation>(i)) << "\": " << binary_operations[i];
+    }
+    o << "}";
+    o << "}" << std::endl;
+}
@@ -0,0 +1,42 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <iostream>
+#include <atomic>
+
+// Build with -DSTATS_ON=0 to compile the counters out of the hot paths.
+#ifndef STATS_ON
+#define STATS_ON 1
+#endif
+
+#if STATS_ON
+#define RECORD_STAT(statement) statement
+#else
+#define RECORD_STAT(statement)
+#endif
+
+struct Stats {
+    long variable_lookups;
+    long variable_lookup_entries_walked;
+    long block_scopes_entered;
+    long function_scopes_entered;
+    std::atomic<long> nodes_allocated;
+    long evaluation_allocations;
+    std::size_t evaluation_bytes_allocated;
+    bool tracking_allocations;
+    std::vector<std::string> function_names;
+    std::vector<long> function_calls;
+    std::vector<long> binary_operations;
+
+    Stats();
+    int register_function(const std::string& name);
+    void print_table(std::ostream& o);
+    void print_json(std::ostream& o);
+};
+
+extern Stats stats;
+
+#endif
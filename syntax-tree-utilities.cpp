@@ -0,0 +1,142 @@
+#include "syntax-tree-utilities.hpp"
+
+void get_children(SyntaxTreeNode* node, std::vector<SyntaxTreeNode*>& children) {
+    switch (node->node_type) {
+        case SyntaxTreeNodeType::STATEMENT_SEQUENCE:
+            for (SyntaxTreeNode* statement : static_cast<StatementSequenceNode*>(node)->statements) children.push_back(statement);
+            break;
+        case SyntaxTreeNodeType::RETURN:
+            children.push_back(static_cast<ReturnNode*>(node)->value);
+            break;
+        case SyntaxTreeNodeType::ASSIGNMENT:
+            children.push_back(static_cast<AssignmentNode*>(node)->value);
+            break;
+        case SyntaxTreeNodeType::PRINT:
+            children.push_back(static_cast<PrintNode*>(node)->value);
+            break;
+        case SyntaxTreeNodeType::BINARY_OPERATION: {
+            BinaryOperationNode* binary_operation_node = static_cast<BinaryOperationNode*>(node);
+            children.push_back(binary_operation_node->left_operand);
+            children.push_back(binary_operation_node->right_operand);
+            break;
+        }
+        case SyntaxTreeNodeType::IF_ELSE: {
+            IfElseNode* if_else_node = static_cast<IfElseNode*>(node);
+            children.push_back(if_else_node->condition);
+            children.push_back(if_else_node->if_block);
+            children.push_back(if_else_node->else_block);
+            break;
+        }
+        case SyntaxTreeNodeType::FUNCTION_CALL:
+            for (std::pair<const std::string, SyntaxTreeNode*>& argument : static_cast<FunctionNode*>(node)->arguments) children.push_back(argument.second);
+            break;
+        case SyntaxTreeNodeType::BUILTIN_CALL:
+            for (SyntaxTreeNode* argument : static_cast<BuiltinCallNode*>(node)->arguments) children.push_back(argument);
+            break;
+        case SyntaxTreeNodeType::WHILE: {
+            WhileNode* while_node = static_cast<WhileNode*>(node);
+            children.push_back(while_node->condition);
+            if (while_node->preheader != nullptr) children.push_back(while_node->preheader);
+            children.push_back(while_node->body);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void collect_assignments(SyntaxTreeNode* node, std::map<std::string, int>& assignment_counts) {
+    if (node->node_type == SyntaxTreeNodeType::ASSIGNMENT) assignment_counts[static_cast<AssignmentNode*>(node)->variable_name]++;
+    std::vector<SyntaxTreeNode*> children;
+    get_children(node, children);
+    for (SyntaxTreeNode* child : children) collect_assignments(child, assignment_counts);
+}
+
+void collect_reads(SyntaxTreeNode* node, std::set<std::string>& reads) {
+    if (node->node_type == SyntaxTreeNodeType::OPERAND) {
+        OperandNode* operand_node = static_cast<OperandNode*>(node);
+        if (operand_node->operand_type == IDENTIFIER) reads.insert(operand_node->identifier_value);
+    }
+    std::vector<SyntaxTreeNode*> children;
+    get_children(node, children);
+    for (SyntaxTreeNode* child : children) collect_reads(child, reads);
+}
+
+void collect_calls(SyntaxTreeNode* node, std::set<const FunctionData*>& calls) {
+    if (node->node_type == SyntaxTreeNodeType::FUNCTION_CALL) calls.insert(static_cast<FunctionNode*>(node)->function);
+    std::vector<SyntaxTreeNode*> children;
+    get_children(node, children);
+    for (SyntaxTreeNode* child : children) collect_calls(child, calls);
+}
+
+bool contains_node_type(SyntaxTreeNode* node, SyntaxTreeNodeType type) {
+    if (node->node_type == type) return true;
+    std::vector<SyntaxTreeNode*> children;
+    get_children(node, children);
+    for (SyntaxTreeNode* child : children) {
+        if (contains_node_type(child, type)) return true;
+    }
+    return false;
+}
+
+bool contains_impure_builtin_call(SyntaxTreeNode* node) {
+    if (node->node_type == SyntaxTreeNodeType::BUILTIN_CALL && !static_cast<BuiltinCallNode*>(node)->builtin->is_pure) return true;
+    std::vector<SyntaxTreeNode*> children;
+    get_children(node, children);
+    for (SyntaxTreeNode* child : children) {
+        if (contains_impure_builtin_call(child)) return true;
+    }
+    return false;
+}
+
+SyntaxTreeNode* clone_syntax_tree(SyntaxTreeNode* node) {
+    switch (node->node_type) {
+        case SyntaxTreeNodeType::STATEMENT_SEQUENCE: {
+            std::vector<SyntaxTreeNode*> statements;
+            for (SyntaxTreeNode* statement : static_cast<StatementSequenceNode*>(node)->statements) statements.push_back(clone_syntax_tree(statement));
+            return new StatementSequenceNode(statements);
+        }
+        case SyntaxTreeNodeType::OPERAND: {
+            OperandNode* operand_node = static_cast<OperandNode*>(node);
+            if (operand_node->operand_type == LITERAL) return new OperandNode(LITERAL, operand_node->literal_value);
+            else return new OperandNode(IDENTIFIER, operand_node->identifier_value);
+        }
+        case SyntaxTreeNodeType::RETURN:
+            return new ReturnNode(clone_syntax_tree(static_cast<ReturnNode*>(node)->value));
+        case SyntaxTreeNodeType::ASSIGNMENT: {
+            AssignmentNode* assignment_node = static_cast<AssignmentNode*>(node);
+            return new AssignmentNode(assignment_node->variable_name, clone_syntax_tree(assignment_node->value));
+        }
+        case SyntaxTreeNodeType::BINARY_OPERATION: {
+            BinaryOperationNode* binary_operation_node = static_cast<BinaryOperationNode*>(node);
+            return new BinaryOperationNode(binary_operation_node->operation, clone_syntax_tree(binary_operation_node->left_operand), clone_syntax_tree(binary_operation_node->right_operand));
+        }
+        case SyntaxTreeNodeType::IF_ELSE: {
+            IfElseNode* if_else_node = static_cast<IfElseNode*>(node);
+            return new IfElseNode(clone_syntax_tree(if_else_node->condition), clone_syntax_tree(if_else_node->if_block), clone_syntax_tree(if_else_node->else_block));
+        }
+        case SyntaxTreeNodeType::FUNCTION_CALL: {
+            FunctionNode* function_node = static_cast<FunctionNode*>(node);
+            std::map<std::string, SyntaxTreeNode*> arguments;
+            for (std::pair<const std::string, SyntaxTreeNode*>& argument : function_node->arguments) arguments[argument.first] = clone_syntax_tree(argument.second);
+            return new FunctionNode(function_node->function, arguments);
+        }
+        case SyntaxTreeNodeType::BUILTIN_CALL: {
+            BuiltinCallNode* builtin_call_node = static_cast<BuiltinCallNode*>(node);
+            std::vector<SyntaxTreeNode*> arguments;
+            for (SyntaxTreeNode* argument : builtin_call_node->arguments) arguments.push_back(clone_syntax_tree(argument));
+            return new BuiltinCallNode(builtin_call_node->builtin, arguments);
+        }
+        case SyntaxTreeNodeType::PRINT:
+            return new PrintNode(clone_syntax_tree(static_cast<PrintNode*>(node)->value));
+        case SyntaxTreeNodeType::EMPTY:
+            return new EmptyNode();
+        case SyntaxTreeNodeType::WHILE: {
+            WhileNode* while_node = static_cast<WhileNode*>(node);
+            WhileNode* clone = new WhileNode(clone_syntax_tree(while_node->condition), clone_syntax_tree(while_node->body));
+            if (while_node->preheader != nullptr) clone->preheader = clone_syntax_tree(while_node->preheader);
+            return clone;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,20 @@
+#ifndef SYNTAX_TREE_UTILITIES_H
+#define SYNTAX_TREE_UTILITIES_H
+
+#include "syntax-tree.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+
+// Helpers shared by the passes that analyze or rewrite the syntax tree.
+// Function bodies are not children of the nodes that call them.
+void get_children(SyntaxTreeNode* node, std::vector<SyntaxTreeNode*>& children);
+void collect_assignments(SyntaxTreeNode* node, std::map<std::string, int>& assignment_counts);
+void collect_reads(SyntaxTreeNode* node, std::set<std::string>& reads);
+void collect_calls(SyntaxTreeNode* node, std::set<const FunctionData*>& calls);
+bool contains_node_type(SyntaxTreeNode* node, SyntaxTreeNodeType type);
+bool contains_impure_builtin_call(SyntaxTreeNode* node);
+SyntaxTreeNode* clone_syntax_tree(SyntaxTreeNode* node);
+
+#endif
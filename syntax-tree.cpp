@@ -2,11 +2,11 @@
 #include "debug.hpp"
 
 std::ostream& operator<<(std::ostream& o, Variables& variables) {
-    std::vector<Variables::VariableMap> scoped_variables = variables.scoped_variables;
-    for (int i = 0; i < scoped_variables.size(); i++) {
+    for (std::size_t i = 0; i < variables.scope_starts.size(); i++) {
+        int scope_end = i + 1 < variables.scope_starts.size() ? variables.scope_starts[i + 1] : variables.entries.size();
         o << "Scope " << i << ":" << std::endl;
-        for (std::pair<std::string, int> variable_map_entry : scoped_variables[i]) {
-            o << variable_map_entry.first << " = " << variable_map_entry.second << std::endl;
+        for (int j = variables.scope_starts[i]; j < scope_end; j++) {
+            o << *variables.entries[j].name << " = " << variables.entries[j].value << std::endl;
         }
     }
     return o;
@@ -14,44 +14,58 @@ std::ostream& operator<<(std::ostream& o, Variables& variables) {
 
 
 int Variables::get_variable_value(const std::string& variable_name) {
-    int scope_limit = function_scope_indices.top();
-    for (int i = scoped_variables.size() - 1; i >= scope_limit; i--) {
-        VariableMap& variable_map = scoped_variables[i];
-        if (variable_map.find(variable_name) != variable_map.end()) return variable_map[variable_name];
+    RECORD_STAT(stats.variable_lookups++);
+    int scope_limit = function_scope_starts.back();
+    for (int i = entries.size() - 1; i >= scope_limit; i--) {
+        RECORD_STAT(stats.variable_lookup_entries_walked++);
+        if (entries[i].name == &variable_name || *entries[i].name == variable_name) return entries[i].value;
     }
     std::cerr << "ERROR: COULD NOT FIND VALUE FOR VARIABLE " << variable_name << std::endl;
     return -1;
 }
 
 void Variables::assign_variable_and_initialize_if_necessary(const std::string& variable_name, int value) {
-    int scope_limit = function_scope_indices.top();
-    for (int i = scoped_variables.size() - 1; i >= scope_limit; i--) {
-        VariableMap& variable_map = scoped_variables[i];
-        if (variable_map.find(variable_name) != variable_map.end()) {
-            variable_map[variable_name] = value;
+    int scope_limit = function_scope_starts.back();
+    for (int i = entries.size() - 1; i >= scope_limit; i--) {
+        if (entries[i].name == &variable_name || *entries[i].name == variable_name) {
+            entries[i].value = value;
             return;
         }
     }
 
-    scoped_variables.back()[variable_name] = value;
+    entries.push_back(Variable { &variable_name, value });
 }
 
 void Variables::enter_block_scope() {
-    scoped_variables.push_back(VariableMap());
+    RECORD_STAT(stats.block_scopes_entered++);
+    scope_starts.push_back(entries.size());
 }
 
 void Variables::exit_block_scope() {
-    scoped_variables.pop_back();
+    entries.resize(scope_starts.back());
+    scope_starts.pop_back();
 }
 
 void Variables::enter_function_scope() {
-    scoped_variables.push_back(VariableMap());
-    function_scope_indices.push(scoped_variables.size() - 1);
+    RECORD_STAT(stats.function_scopes_entered++);
+    scope_starts.push_back(entries.size());
+    function_scope_starts.push_back(entries.size());
 }
 
 void Variables::exit_function_scope() {
-    scoped_variables.pop_back();
-    function_scope_indices.pop();
+    entries.resize(scope_starts.back());
+    scope_starts.pop_back();
+    function_scope_starts.pop_back();
+}
+
+std::size_t Variables::estimated_memory_usage() {
+    return entries.capacity() * sizeof(Variable) + (scope_starts.capacity() + function_scope_starts.capacity()) * sizeof(int);
+}
+
+void Variables::release_unused_memory() {
+    entries.shrink_to_fit();
+    scope_starts.shrink_to_fit();
+    function_scope_starts.shrink_to_fit();
 }
 
 std::string get_node_type_string_from_enum(SyntaxTreeNodeType type) {
@@ -76,9 +90,30 @@ std::string get_node_type_string_from_enum(SyntaxTreeNodeType type) {
             return "EMPTY";
         case SyntaxTreeNodeType::WHILE:
             return "WHILE";
+        case SyntaxTreeNodeType::BUILTIN_CALL:
+            return "BUILTIN_CALL";
     }
 }
 
+std::string get_binary_operation_string(BinaryOperation operation) {
+    switch (operation) {
+        case BinaryOperation::ADD: return "+";
+        case BinaryOperation::SUBTRACT: return "-";
+        case BinaryOperation::MULTIPLY: return "*";
+        case BinaryOperation::DIVIDE: return "/";
+        case BinaryOperation::MOD: return "%";
+        case BinaryOperation::LESS: return "<";
+        case BinaryOperation::LESS_EQUAL: return "<=";
+        case BinaryOperation::GREATER: return ">";
+        case BinaryOperation::GREATER_EQUAL: return ">=";
+        case BinaryOperation::EQUAL: return "==";
+        case BinaryOperation::NOT_EQUAL: return "!=";
+        case BinaryOperation::AND: return "&&";
+        case BinaryOperation::OR: return "||";
+    }
+    return "?";
+}
+
 std::ostream& operator<<(std::ostream& o, const SyntaxTreeNode* node) {
     std::string node_type_string = get_node_type_string_from_enum(node->node_type);
     o << node_type_string << " NODE";
@@ -86,10 +121,10 @@ std::ostream& operator<<(std::ostream& o, const SyntaxTreeNode* node) {
 }
 
 
-SyntaxTreeNode::EvaluationResult StatementSequenceNode::evaluate() {
+SyntaxTreeNode::EvaluationResult StatementSequenceNode::evaluate(Variables& variables) {
     EvaluationResult result;
     for (SyntaxTreeNode* node : statements) {
-        EvaluationResult node_result = node->evaluate();
+        EvaluationResult node_result = node->evaluate(variables);
         if (node_result.should_return) {
             result.return_value =  node_result.return_value;
             result.should_return = true;
@@ -99,7 +134,7 @@ SyntaxTreeNode::EvaluationResult StatementSequenceNode::evaluate() {
     return result;
 }
 
-SyntaxTreeNode::EvaluationResult OperandNode::evaluate() {
+SyntaxTreeNode::EvaluationResult OperandNode::evaluate(Variables& variables) {
     EvaluationResult result;
     switch (operand_type) {
         case IDENTIFIER:
@@ -112,16 +147,16 @@ SyntaxTreeNode::EvaluationResult OperandNode::evaluate() {
     return result;
 }
 
-SyntaxTreeNode::EvaluationResult ReturnNode::evaluate() {
+SyntaxTreeNode::EvaluationResult ReturnNode::evaluate(Variables& variables) {
     EvaluationResult result;
-    result.return_value = value->evaluate().expression_value;
+    result.return_value = value->evaluate(variables).expression_value;
     result.should_return = true;
     return result;
 }
 
-SyntaxTreeNode::EvaluationResult AssignmentNode::evaluate() {
+SyntaxTreeNode::EvaluationResult AssignmentNode::evaluate(Variables& variables) {
     EvaluationResult result;
-    EvaluationResult assignment_value_result = value->evaluate();
+    EvaluationResult assignment_value_result = value->evaluate(variables);
     int assignment_value = assignment_value_result.expression_value;
     if (value->node_type == SyntaxTreeNodeType::FUNCTION_CALL) assignment_value = assignment_value_result.return_value;
     variables.assign_variable_and_initialize_if_necessary(variable_name, assignment_value);
@@ -129,94 +164,77 @@ SyntaxTreeNode::EvaluationResult AssignmentNode::evaluate() {
     return result;
 }
 
-SyntaxTreeNode::EvaluationResult BinaryOperationNode::evaluate() {
-    EvaluationResult result;
-    int left_value = left_operand->evaluate().expression_value;
-    int right_value = right_operand->evaluate().expression_value;
-
-    int expression_value = 0; 
+int apply_binary_operation(BinaryOperation operation, int left_value, int right_value) {
     switch(operation) {
         case BinaryOperation::ADD:
-            expression_value = left_value + right_value;
-            break;
+            return apply_binary_operation<BinaryOperation::ADD>(left_value, right_value);
         case BinaryOperation::SUBTRACT:
-            expression_value = left_value - right_value;
-            break;
+            return apply_binary_operation<BinaryOperation::SUBTRACT>(left_value, right_value);
         case BinaryOperation::MULTIPLY:
-            expression_value = left_value * right_value;
-            break;
+            return apply_binary_operation<BinaryOperation::MULTIPLY>(left_value, right_value);
         case BinaryOperation::DIVIDE:
-            expression_value = left_value / right_value;
-            break;
+            return apply_binary_operation<BinaryOperation::DIVIDE>(left_value, right_value);
         case BinaryOperation::MOD:
-            expression_value = left_value % right_value;
-            break;
+            return apply_binary_operation<BinaryOperation::MOD>(left_value, right_value);
         case BinaryOperation::LESS:
-            expression_value = left_value < right_value;
-            break;
+            return apply_binary_operation<BinaryOperation::LESS>(left_value, right_value);
         case BinaryOperation::LESS_EQUAL:
-            expression_value = left_value <= right_value;
-            break;
+            return apply_binary_operation<BinaryOperation::LESS_EQUAL>(left_value, right_value);
         case BinaryOperation::GREATER:
-            expression_value = left_value > right_value;
-            break;
+            return apply_binary_operation<BinaryOperation::GREATER>(left_value, right_value);
         case BinaryOperation::GREATER_EQUAL:
-            expression_value = left_value >= right_value;
-            break;
+            return apply_binary_operation<BinaryOperation::GREATER_EQUAL>(left_value, right_value);
         case BinaryOperation::EQUAL:
-            expression_value = left_value == right_value;
-            break;
+            return apply_binary_operation<BinaryOperation::EQUAL>(left_value, right_value);
         case BinaryOperation::NOT_EQUAL:
-            expression_value = left_value != right_value;
-            break;
+            return apply_binary_operation<BinaryOperation::NOT_EQUAL>(left_value, right_value);
         case BinaryOperation::AND:
-            expression_value = (left_value != 0) && (right_value != 0);
-            break;
+            return apply_binary_operation<BinaryOperation::AND>(left_value, right_value);
         case BinaryOperation::OR:
-            expression_value = (left_value != 0) || (right_value != 0);
-            break;
+            return apply_binary_operation<BinaryOperation::OR>(left_value, right_value);
     }
+    return 0;
+}
 
-    result.expression_value = expression_value;
+SyntaxTreeNode::EvaluationResult BinaryOperationNode::evaluate(Variables& variables) {
+    EvaluationResult result;
+    int left_value = left_operand->evaluate(variables).expression_value;
+    int right_value = right_operand->evaluate(variables).expression_value;
+    RECORD_STAT(stats.binary_operations[operation]++);
+    result.expression_value = apply_binary_operation(operation, left_value, right_value);
     return result;
 }
 
-SyntaxTreeNode::EvaluationResult IfElseNode::evaluate() {
-    int condition_value = condition->evaluate().expression_value;
-    if (condition_value) return if_block->evaluate();
-    else return else_block->evaluate();
+SyntaxTreeNode::EvaluationResult IfElseNode::evaluate(Variables& variables) {
+    int condition_value = condition->evaluate(variables).expression_value;
+    if (condition_value) return if_block->evaluate(variables);
+    else return else_block->evaluate(variables);
 }
 
-SyntaxTreeNode::EvaluationResult FunctionNode::evaluate() {
-    std::map<std::string, int> argument_values; 
-    for (std::pair<std::string, SyntaxTreeNode*> argument : arguments) {
-        std::string& variable_name = argument.first;
-        SyntaxTreeNode* node = argument.second; 
-
-        int value = node->evaluate().expression_value;
-
-        argument_values[variable_name] = value;
-    }
+// Calls only run as frames of a CallStack, which never evaluates a call
+// node, so that the call stack's memory limit applies to every call.
+SyntaxTreeNode::EvaluationResult FunctionNode::evaluate(Variables&) {
+    std::cerr << "Error: function calls can only be run by the call stack" << std::endl;
+    return EvaluationResult();
+}
 
-    variables.enter_function_scope();
-    for (std::pair<std::string, int> argument_value : argument_values) {
-        variables.assign_variable_and_initialize_if_necessary(argument_value.first, argument_value.second);
+SyntaxTreeNode::EvaluationResult BuiltinCallNode::evaluate(Variables& variables) {
+    int argument_values[BuiltinRegistry::MAX_ARITY];
+    for (std::size_t i = 0; i < arguments.size(); i++) {
+        argument_values[i] = arguments[i]->evaluate(variables).expression_value;
     }
-
-    EvaluationResult result = body->evaluate();
-    result.should_return = false;
-
-    variables.exit_function_scope();
+    EvaluationResult result;
+    result.expression_value = builtin->function(argument_values, builtin->user_data);
     return result;
 }
 
-SyntaxTreeNode::EvaluationResult EmptyNode::evaluate() {
+SyntaxTreeNode::EvaluationResult EmptyNode::evaluate(Variables&) {
     EvaluationResult result;
     return result;
 }
 
-SyntaxTreeNode::EvaluationResult PrintNode::evaluate() {
-    EvaluationResult value_result = value->evaluate();
+SyntaxTreeNode::EvaluationResult PrintNode::evaluate(Variables& variables) {
+    EvaluationResult value_result = value->evaluate(variables);
     int to_print = 0;
     if (value->node_type == FUNCTION_CALL) to_print = value_result.return_value;
     else to_print = value_result.expression_value;
@@ -224,17 +242,24 @@ SyntaxTreeNode::EvaluationResult PrintNode::evaluate() {
     return EvaluationResult();
 }
 
-SyntaxTreeNode::EvaluationResult WhileNode::evaluate() {
+SyntaxTreeNode::EvaluationResult WhileNode::evaluate(Variables& variables) {
     EvaluationResult result;
-    while (condition->evaluate().expression_value == 1) {
+    if (preheader != nullptr) {
+        if (condition->evaluate(variables).expression_value != 1) return result;
+        variables.enter_block_scope();
+        preheader->evaluate(variables);
+    }
+    while (condition->evaluate(variables).expression_value == 1) {
         variables.enter_block_scope();
-        EvaluationResult current_iteration_result = body->evaluate();
+        EvaluationResult current_iteration_result = body->evaluate(variables);
         if (current_iteration_result.should_return) {
             result.should_return = true;
             result.return_value = current_iteration_result.return_value;
+            variables.exit_block_scope();
             break;
         }
         variables.exit_block_scope();
     }
+    if (preheader != nullptr) variables.exit_block_scope();
     return result;
 }
\ No newline at end of file
@@ -8,17 +8,30 @@
 #include <set>
 #include <unordered_set>
 #include <iostream>
+#include <cassert>
+#include "stats.hpp"
+#include "node-arena.hpp"
+#include "builtins.hpp"
+
+// Variables are kept in one flat list, innermost scope last, and each
+// scope is the range starting at its entry in scope_starts. Entries point
+// at names owned by the syntax tree, so once the vectors have grown,
+// entering scopes and assigning variables does not allocate.
 class Variables {
 private:
-    using VariableMap = std::map<std::string, int>;
-    std::vector<VariableMap> scoped_variables;
+    struct Variable {
+        const std::string* name;
+        int value;
+    };
+    std::vector<Variable> entries;
+    std::vector<int> scope_starts;
+    std::vector<int> function_scope_starts;
     friend std::ostream& operator<<(std::ostream& o, Variables& variables);
-    std::stack<int> function_scope_indices;
 
 public:
-    Variables() : scoped_variables(std::vector<VariableMap>()) {
-        function_scope_indices.push(0);
-        scoped_variables.push_back(VariableMap());
+    Variables() {
+        scope_starts.push_back(0);
+        function_scope_starts.push_back(0);
     }
     int get_variable_value(const std::string& variable_name);
     void assign_variable_and_initialize_if_necessary(const std::string& variable_name, int value);
@@ -26,6 +39,8 @@ public:
     void exit_block_scope();
     void enter_function_scope();
     void exit_function_scope();
+    std::size_t estimated_memory_usage();
+    void release_unused_memory();
 };
 
 std::ostream& operator<<(std::ostream& o, Variables& variables);
@@ -41,7 +56,8 @@ enum SyntaxTreeNodeType {
     FUNCTION_CALL,
     PRINT,
     EMPTY,
-    WHILE
+    WHILE,
+    BUILTIN_CALL
 };
 
 struct SyntaxTreeNode {
@@ -51,18 +67,40 @@ struct SyntaxTreeNode {
         bool should_return;
         EvaluationResult() : expression_value(0), return_value(0), should_return(false) {}
     };
-    virtual EvaluationResult evaluate () = 0;
+    virtual EvaluationResult evaluate(Variables& variables) = 0;
     SyntaxTreeNodeType node_type;
-    Variables& variables;
-    SyntaxTreeNode(SyntaxTreeNodeType type, Variables& variables) : node_type(type), variables(variables) {}
+    SyntaxTreeNode(SyntaxTreeNodeType type) : node_type(type) {
+        RECORD_STAT(stats.nodes_allocated++);
+    }
+    // Copies made by later passes count as allocated nodes too.
+    SyntaxTreeNode(const SyntaxTreeNode& other) : node_type(other.node_type) {
+        RECORD_STAT(stats.nodes_allocated++);
+    }
+    // Nodes can only be created while an arena is current, and are owned
+    // by it. Every node type derives from SyntaxTreeNode alone, so the
+    // node starts at the address the arena allocated.
+    static void* operator new(std::size_t size) {
+        assert(NodeArena::current != nullptr);
+        return NodeArena::current->allocate(size, destroy);
+    }
+    static void operator delete(void*) {}
+
+protected:
+    // Protected so that nodes are not deleted individually.
+    virtual ~SyntaxTreeNode() {}
+
+private:
+    static void destroy(void* pointer) {
+        static_cast<SyntaxTreeNode*>(pointer)->~SyntaxTreeNode();
+    }
 };
 
 std::ostream& operator<<(std::ostream& o, const SyntaxTreeNode* node);
 
 struct StatementSequenceNode : SyntaxTreeNode {
     std::vector<SyntaxTreeNode*> statements;
-    StatementSequenceNode(std::vector<SyntaxTreeNode*>& statements, Variables& variables) : statements(statements), SyntaxTreeNode(STATEMENT_SEQUENCE, variables) {}
-    EvaluationResult evaluate();
+    StatementSequenceNode(std::vector<SyntaxTreeNode*>& statements) : statements(statements), SyntaxTreeNode(STATEMENT_SEQUENCE) {}
+    EvaluationResult evaluate(Variables& variables);
 };
 
 enum OperandType {
@@ -73,69 +111,110 @@ struct OperandNode : SyntaxTreeNode {
     OperandType operand_type;
     std::string identifier_value;
     int literal_value;
-    OperandNode(OperandType operand_type, std::string identifier_value, Variables& variables) : operand_type(operand_type), identifier_value(identifier_value), SyntaxTreeNode(OPERAND, variables) {}
-    OperandNode(OperandType operand_type, int literal_value, Variables& variables) : operand_type(operand_type), literal_value(literal_value), SyntaxTreeNode(OPERAND, variables) {}
-    EvaluationResult evaluate();
+    OperandNode(OperandType operand_type, std::string identifier_value) : operand_type(operand_type), identifier_value(identifier_value), literal_value(0), SyntaxTreeNode(OPERAND) {}
+    OperandNode(OperandType operand_type, int literal_value) : operand_type(operand_type), literal_value(literal_value), SyntaxTreeNode(OPERAND) {}
+    EvaluationResult evaluate(Variables& variables);
 };
 
 struct ReturnNode : SyntaxTreeNode {
     SyntaxTreeNode* value;
-    ReturnNode(SyntaxTreeNode* value, Variables& variables) : value(value), SyntaxTreeNode(RETURN, variables) {}
-    EvaluationResult evaluate();
+    ReturnNode(SyntaxTreeNode* value) : value(value), SyntaxTreeNode(RETURN) {}
+    EvaluationResult evaluate(Variables& variables);
 };
 
 struct AssignmentNode : SyntaxTreeNode {
     std::string variable_name;
     SyntaxTreeNode* value;
-    EvaluationResult evaluate();
-    AssignmentNode(std::string variable_name, SyntaxTreeNode* value, Variables& variables) : variable_name(variable_name), value(value), SyntaxTreeNode(ASSIGNMENT, variables) {}
+    EvaluationResult evaluate(Variables& variables);
+    AssignmentNode(std::string variable_name, SyntaxTreeNode* value) : variable_name(variable_name), value(value), SyntaxTreeNode(ASSIGNMENT) {}
 };
 
 enum BinaryOperation {
     ADD, SUBTRACT, MULTIPLY, DIVIDE, MOD, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, EQUAL, NOT_EQUAL, AND, OR
 };
 
+template <BinaryOperation operation>
+inline int apply_binary_operation(int left_value, int right_value) {
+    if constexpr (operation == BinaryOperation::ADD) return left_value + right_value;
+    else if constexpr (operation == BinaryOperation::SUBTRACT) return left_value - right_value;
+    else if constexpr (operation == BinaryOperation::MULTIPLY) return left_value * right_value;
+    else if constexpr (operation == BinaryOperation::DIVIDE) return left_value / right_value;
+    else if constexpr (operation == BinaryOperation::MOD) return left_value % right_value;
+    else if constexpr (operation == BinaryOperation::LESS) return left_value < right_value;
+    else if constexpr (operation == BinaryOperation::LESS_EQUAL) return left_value <= right_value;
+    else if constexpr (operation == BinaryOperation::GREATER) return left_value > right_value;
+    else if constexpr (operation == BinaryOperation::GREATER_EQUAL) return left_value >= right_value;
+    else if constexpr (operation == BinaryOperation::EQUAL) return left_value == right_value;
+    else if constexpr (operation == BinaryOperation::NOT_EQUAL) return left_value != right_value;
+    else if constexpr (operation == BinaryOperation::AND) return (left_value != 0) && (right_value != 0);
+    else return (left_value != 0) || (right_value != 0);
+}
+
+int apply_binary_operation(BinaryOperation operation, int left_value, int right_value);
+
 struct BinaryOperationNode : SyntaxTreeNode {
     BinaryOperation operation;
     SyntaxTreeNode* left_operand;
     SyntaxTreeNode* right_operand;
-    BinaryOperationNode(BinaryOperation operation, SyntaxTreeNode* left_operand, SyntaxTreeNode* right_operand, Variables& variables) : operation(operation), left_operand(left_operand), right_operand(right_operand), SyntaxTreeNode(BINARY_OPERATION, variables) {}
-    EvaluationResult evaluate();
+    BinaryOperationNode(BinaryOperation operation, SyntaxTreeNode* left_operand, SyntaxTreeNode* right_operand) : operation(operation), left_operand(left_operand), right_operand(right_operand), SyntaxTreeNode(BINARY_OPERATION) {}
+    EvaluationResult evaluate(Variables& variables);
 };
 
 struct IfElseNode : SyntaxTreeNode {
     SyntaxTreeNode* condition;
     SyntaxTreeNode* if_block;
     SyntaxTreeNode* else_block;
-    IfElseNode(SyntaxTreeNode* condition, SyntaxTreeNode* if_block, SyntaxTreeNode* else_block, Variables& variables) : condition(condition), if_block(if_block), else_block(else_block), SyntaxTreeNode(IF_ELSE, variables) {}
-    EvaluationResult evaluate();
+    IfElseNode(SyntaxTreeNode* condition, SyntaxTreeNode* if_block, SyntaxTreeNode* else_block) : condition(condition), if_block(if_block), else_block(else_block), SyntaxTreeNode(IF_ELSE) {}
+    EvaluationResult evaluate(Variables& variables);
 };
 
-struct FunctionNode : SyntaxTreeNode {
+// The body is filled in once the definition has been parsed, which lets
+// a function body call itself or a function defined later in the file.
+struct FunctionData {
+    std::string name;
     SyntaxTreeNode* body;
+    std::vector<std::string> parameters;
+    int id;
+};
+
+struct FunctionNode : SyntaxTreeNode {
+    const FunctionData* function;
     std::map<std::string, SyntaxTreeNode*> arguments;
-    FunctionNode(SyntaxTreeNode* body, std::map<std::string, SyntaxTreeNode*> arguments, Variables& variables) : body(body), arguments(arguments), SyntaxTreeNode(FUNCTION_CALL, variables) {}
-    EvaluationResult evaluate();
+    FunctionNode(const FunctionData* function, std::map<std::string, SyntaxTreeNode*> arguments) : function(function), arguments(arguments), SyntaxTreeNode(FUNCTION_CALL) {}
+    EvaluationResult evaluate(Variables& variables);
+};
+
+// Evaluates like an expression: the result is the expression value, not
+// a return value, and no frame or scope is created.
+struct BuiltinCallNode : SyntaxTreeNode {
+    const Builtin* builtin;
+    std::vector<SyntaxTreeNode*> arguments;
+    BuiltinCallNode(const Builtin* builtin, std::vector<SyntaxTreeNode*>& arguments) : builtin(builtin), arguments(arguments), SyntaxTreeNode(BUILTIN_CALL) {}
+    EvaluationResult evaluate(Variables& variables);
 };
 
 struct PrintNode : SyntaxTreeNode {
     SyntaxTreeNode* value; 
-    PrintNode(SyntaxTreeNode* value, Variables& variables) : value(value), SyntaxTreeNode(PRINT, variables) {}
-    EvaluationResult evaluate();
+    PrintNode(SyntaxTreeNode* value) : value(value), SyntaxTreeNode(PRINT) {}
+    EvaluationResult evaluate(Variables& variables);
 };
 
 struct EmptyNode : SyntaxTreeNode {
-    EmptyNode(Variables& variables) : SyntaxTreeNode(EMPTY, variables) {}
-    EvaluationResult evaluate();
+    EmptyNode() : SyntaxTreeNode(EMPTY) {}
+    EvaluationResult evaluate(Variables& variables);
 };
 
+// The preheader holds loop invariant statements hoisted out of the body.
+// It runs once, in its own block scope, if the condition initially holds.
 struct WhileNode : SyntaxTreeNode {
     SyntaxTreeNode* condition;
     SyntaxTreeNode* body;
-    WhileNode(Variables& variables, SyntaxTreeNode* condition, SyntaxTreeNode* body) : condition(condition), body(body), SyntaxTreeNode(WHILE, variables) {}
-    EvaluationResult evaluate();
+    SyntaxTreeNode* preheader;
+    WhileNode(SyntaxTreeNode* condition, SyntaxTreeNode* body) : condition(condition), body(body), preheader(nullptr), SyntaxTreeNode(WHILE) {}
+    EvaluationResult evaluate(Variables& variables);
 };
 
 std::string get_node_type_string_from_enum(SyntaxTreeNodeType type);
+std::string get_binary_operation_string(BinaryOperation operation);
 
 #endif
\ No newline at end of file